@@ -3,11 +3,28 @@
  * documentation, license, etc.
  */
 
+#define _POSIX_C_SOURCE 200809L // for fseeko, ftello, fileno, and posix_madvise
+#define _FILE_OFFSET_BITS 64 // so that they take 64-bit offsets everywhere
+
 #include "ansel2utf8.h"
+#include "gedscan.h"
 
-#include <string.h> // strcasecmp
+#include <string.h> // memcpy, memmove
+#include <strings.h> // strcasecmp
 #include <ctype.h> // isspace
-#include <stdio.h>  // FILE*, fseek, etc
+#include <stdio.h>  // FILE*, fread, etc
+#include <stdlib.h> // malloc, realloc, free
+#include <stdint.h> // uint32_t
+#include <assert.h>
+
+#ifdef _WIN32
+#include <windows.h> // CreateFileMapping, MapViewOfFile
+#include <io.h>      // _get_osfhandle
+#elif defined(__unix__) || defined(__APPLE__)
+#define GED_HAVE_MMAP
+#include <sys/mman.h> // mmap, posix_madvise
+#include <sys/stat.h> // fstat
+#endif
 
 
 const char *codec_names[] = {
@@ -22,44 +39,150 @@ const char *codec_names[] = {
 };
 
 
+/**
+ * Reads the next block of the file into `s->in`, returning the number
+ * of undecoded bytes now available. While sniffing, the buffer grows
+ * instead of being overwritten so the reader can rewind without seeking.
+ */
+static size_t decoding_refill(DecodingFileReader *s) {
+    if (!s->f) {
+        // in-memory input: everything is already in `in`
+    } else if (s->sniffing) {
+        if (s->inlen == s->incap) {
+            s->incap *= 2;
+            s->in = realloc(s->in, s->incap);
+        }
+        s->inlen += fread(s->in + s->inlen, 1, s->incap - s->inlen, s->f);
+    } else {
+        s->inbase += s->inlen;
+        s->inpos = 0;
+        s->inlen = fread(s->in, 1, s->incap, s->f);
+    }
+    return s->inlen - s->inpos;
+}
+
+/// buffered replacement for decoding_getc(s)
+static inline int decoding_getc(DecodingFileReader *s) {
+    if (s->inpos >= s->inlen && !decoding_refill(s)) return EOF;
+    return s->in[s->inpos++];
+}
+
+/// fseek(f, offset, SEEK_SET), but past 2GB on every platform
+static int decoding_fseek(FILE *f, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+/// ftell(f), but past 2GB on every platform
+static int64_t decoding_ftell(FILE *f) {
+#ifdef _WIN32
+    return _ftelli64(f);
+#else
+    return ftello(f);
+#endif
+}
+
+/**
+ * Moves the reader to file offset `offset`, seeking only if that 
+ * offset is not already buffered, and clears all decoding state.
+ */
+static void decoding_seek(DecodingFileReader *s, int64_t offset) {
+    if (offset < s->inbase || offset > s->inbase + (int64_t)s->inlen) {
+        decoding_fseek(s->f, offset);
+        s->inbase = offset;
+        s->inlen = 0;
+    }
+    s->inpos = offset - s->inbase;
+    s->out = s->outbuf;
+    s->outpos = s->outlen = 0;
+    s->pending = 0;
+    s->hc1 = s->hc2 = s->lc = s->mid = 0;
+}
+
+
+/// code points of ANSEL bytes from 0xA1 through 0xFF; negative if unmapped
+static const int ansel_special[] = {
+    0x141, 0xD8, 0x110, 0xDE, 0xC6, 0x152, 0x2B9, 
+    0xB7, 0x266D, 0xAE, 0xB1, 0x1A0, 0x1AF, 0x2BE, -0xAF, 
+    0x2BF, 0x142, 0xF8, 0x111, 0xFE, 0xE6, 0x153, 0x2BA, 
+    0x131, 0xA3, 0xF0, -0xBB, 0x1A1, 0x1B0, 0x25A1, 0x25A0, 
+    0xB0, 0x2113, 0x2117, 0xA9, 0x2667, 0xBF, 0xA1, 0xDF, 
+    0x20AC, -0xC9, -0xCA, -0xCB, -0xCC, 0x65, 0x6F, 0xDF, 
+    -0xD0, -0xD1, -0xD2, -0xD3, -0xD4, -0xD5, -0xD6, -0xD7,
+    -0xD8, -0xD9, -0xDA, -0xDB, -0xDC, -0xDD, -0xDE, -0xDF, 
+    0x309, 0x300, 0x301, 0x302, 0x303, 0x304, 0x306, 0x307, 
+    0x308, 0x30C, 0x30A, 0xFE20, 0xFE21, 0x315, 0x30B, 0x310, 
+    0x327, 0x328, 0x323, 0x324, 0x325, 0x333, 0x332, 0x326, 
+    0x328, 0x32E, 0xFE22, 0xFE23, 0x338, -0xFD, 0x313, -0xFF
+};
+
+enum ansel_kind { 
+    ANSEL_ERROR = 0, // unmapped by every known ANSEL variant
+    ANSEL_GLYPH, // a character on its own
+    ANSEL_HIGH, ANSEL_LOW, ANSEL_MID, // a diacritic that precedes its base
+};
+
+/**
+ * `ansel_special` pre-encoded as UTF-8 for `ansel_decode_block`.
+ * ASCII is copied without looking here; other missing bytes are errors.
+ */
+static const struct ansel_char {
+    unsigned char kind, len, utf8[3];
+} ansel_table[256] = {
+    [0xA1]={ANSEL_GLYPH,2,{0xC5,0x81}}, [0xA2]={ANSEL_GLYPH,2,{0xC3,0x98}}, [0xA3]={ANSEL_GLYPH,2,{0xC4,0x90}},
+    [0xA4]={ANSEL_GLYPH,2,{0xC3,0x9E}}, [0xA5]={ANSEL_GLYPH,2,{0xC3,0x86}}, [0xA6]={ANSEL_GLYPH,2,{0xC5,0x92}},
+    [0xA7]={ANSEL_GLYPH,2,{0xCA,0xB9}}, [0xA8]={ANSEL_GLYPH,2,{0xC2,0xB7}}, [0xA9]={ANSEL_GLYPH,3,{0xE2,0x99,0xAD}},
+    [0xAA]={ANSEL_GLYPH,2,{0xC2,0xAE}}, [0xAB]={ANSEL_GLYPH,2,{0xC2,0xB1}}, [0xAC]={ANSEL_GLYPH,2,{0xC6,0xA0}},
+    [0xAD]={ANSEL_GLYPH,2,{0xC6,0xAF}}, [0xAE]={ANSEL_GLYPH,2,{0xCA,0xBE}}, [0xB0]={ANSEL_GLYPH,2,{0xCA,0xBF}},
+    [0xB1]={ANSEL_GLYPH,2,{0xC5,0x82}}, [0xB2]={ANSEL_GLYPH,2,{0xC3,0xB8}}, [0xB3]={ANSEL_GLYPH,2,{0xC4,0x91}},
+    [0xB4]={ANSEL_GLYPH,2,{0xC3,0xBE}}, [0xB5]={ANSEL_GLYPH,2,{0xC3,0xA6}}, [0xB6]={ANSEL_GLYPH,2,{0xC5,0x93}},
+    [0xB7]={ANSEL_GLYPH,2,{0xCA,0xBA}}, [0xB8]={ANSEL_GLYPH,2,{0xC4,0xB1}}, [0xB9]={ANSEL_GLYPH,2,{0xC2,0xA3}},
+    [0xBA]={ANSEL_GLYPH,2,{0xC3,0xB0}}, [0xBC]={ANSEL_GLYPH,2,{0xC6,0xA1}}, [0xBD]={ANSEL_GLYPH,2,{0xC6,0xB0}},
+    [0xBE]={ANSEL_GLYPH,3,{0xE2,0x96,0xA1}}, [0xBF]={ANSEL_GLYPH,3,{0xE2,0x96,0xA0}}, [0xC0]={ANSEL_GLYPH,2,{0xC2,0xB0}},
+    [0xC1]={ANSEL_GLYPH,3,{0xE2,0x84,0x93}}, [0xC2]={ANSEL_GLYPH,3,{0xE2,0x84,0x97}}, [0xC3]={ANSEL_GLYPH,2,{0xC2,0xA9}},
+    [0xC4]={ANSEL_GLYPH,3,{0xE2,0x99,0xA7}}, [0xC5]={ANSEL_GLYPH,2,{0xC2,0xBF}}, [0xC6]={ANSEL_GLYPH,2,{0xC2,0xA1}},
+    [0xC7]={ANSEL_GLYPH,2,{0xC3,0x9F}}, [0xC8]={ANSEL_GLYPH,3,{0xE2,0x82,0xAC}}, [0xCD]={ANSEL_GLYPH,1,{0x65}},
+    [0xCE]={ANSEL_GLYPH,1,{0x6F}}, [0xCF]={ANSEL_GLYPH,2,{0xC3,0x9F}}, [0xE0]={ANSEL_HIGH,2,{0xCC,0x89}},
+    [0xE1]={ANSEL_HIGH,2,{0xCC,0x80}}, [0xE2]={ANSEL_HIGH,2,{0xCC,0x81}}, [0xE3]={ANSEL_HIGH,2,{0xCC,0x82}},
+    [0xE4]={ANSEL_HIGH,2,{0xCC,0x83}}, [0xE5]={ANSEL_HIGH,2,{0xCC,0x84}}, [0xE6]={ANSEL_HIGH,2,{0xCC,0x86}},
+    [0xE7]={ANSEL_HIGH,2,{0xCC,0x87}}, [0xE8]={ANSEL_HIGH,2,{0xCC,0x88}}, [0xE9]={ANSEL_HIGH,2,{0xCC,0x8C}},
+    [0xEA]={ANSEL_HIGH,2,{0xCC,0x8A}}, [0xEB]={ANSEL_HIGH,3,{0xEF,0xB8,0xA0}}, [0xEC]={ANSEL_HIGH,3,{0xEF,0xB8,0xA1}},
+    [0xED]={ANSEL_HIGH,2,{0xCC,0x95}}, [0xEE]={ANSEL_HIGH,2,{0xCC,0x8B}}, [0xEF]={ANSEL_HIGH,2,{0xCC,0x90}},
+    [0xF0]={ANSEL_LOW,2,{0xCC,0xA7}}, [0xF1]={ANSEL_LOW,2,{0xCC,0xA8}}, [0xF2]={ANSEL_LOW,2,{0xCC,0xA3}},
+    [0xF3]={ANSEL_LOW,2,{0xCC,0xA4}}, [0xF4]={ANSEL_LOW,2,{0xCC,0xA5}}, [0xF5]={ANSEL_LOW,2,{0xCC,0xB3}},
+    [0xF6]={ANSEL_LOW,2,{0xCC,0xB2}}, [0xF7]={ANSEL_LOW,2,{0xCC,0xA6}}, [0xF8]={ANSEL_LOW,2,{0xCC,0xA8}},
+    [0xF9]={ANSEL_LOW,2,{0xCC,0xAE}}, [0xFA]={ANSEL_HIGH,3,{0xEF,0xB8,0xA2}}, [0xFB]={ANSEL_HIGH,3,{0xEF,0xB8,0xA3}},
+    [0xFC]={ANSEL_MID,2,{0xCC,0xB8}}, [0xFE]={ANSEL_HIGH,2,{0xCC,0x93}},
+};
+
+
 int ansel_next_codepoint(DecodingFileReader *s) {
-    static int special[] = { // code points of ANSEL bytes from 0xA1 through 0xFF
-        0x141, 0xD8, 0x110, 0xDE, 0xC6, 0x152, 0x2B9, 
-        0xB7, 0x266D, 0xAE, 0xB1, 0x1A0, 0x1AF, 0x2BE, -0xAF, 
-        0x2BF, 0x142, 0xF8, 0x111, 0xFE, 0xE6, 0x153, 0x2BA, 
-        0x131, 0xA3, 0xF0, -0xBB, 0x1A1, 0x1B0, 0x25A1, 0x25A0, 
-        0xB0, 0x2113, 0x2117, 0xA9, 0x2667, 0xBF, 0xA1, 0xDF, 
-        0x20AC, -0xC9, -0xCA, -0xCB, -0xCC, 0x65, 0x6F, 0xDF, 
-        -0xD0, -0xD1, -0xD2, -0xD3, -0xD4, -0xD5, -0xD6, -0xD7,
-        -0xD8, -0xD9, -0xDA, -0xDB, -0xDC, -0xDD, -0xDE, -0xDF, 
-        0x309, 0x300, 0x301, 0x302, 0x303, 0x304, 0x306, 0x307, 
-        0x308, 0x30C, 0x30A, 0xFE20, 0xFE21, 0x315, 0x30B, 0x310, 
-        0x327, 0x328, 0x323, 0x324, 0x325, 0x333, 0x332, 0x326, 
-        0x328, 0x32E, 0xFE22, 0xFE23, 0x338, -0xFD, 0x313, -0xFF
-    };
     if (s->mid) { int tmp = s->mid; s->mid = 0; return tmp; }
     if (s->lc) { return s->low[--(s->lc)]; }
     if (s->hc1 != s->hc2) { int tmp = s->high[s->hc2]; s->hc2 = (s->hc2+1)&0xF; return tmp; }
     
-    int b = fgetc(s->f);
+    int b = decoding_getc(s);
     if (b < 0) return b; // EOF and other read errors
     if (b > 0xFF) return -b; // larger than a byte? Should be impossible
     if (b < 0x80) return b; // ASCII
     if (b < 0xA1) return -b; // unmapped by every known ANSEL variant
-    if (b < 0xE0 || special[b-0xA1] < 0) // single glyph or unmapped
-        return special[b-0xA1];
+    if (b < 0xE0 || ansel_special[b-0xA1] < 0) // single glyph or unmapped
+        return ansel_special[b-0xA1];
     
     // combining: get the answer first, then push diacritics into queue
     int ans = ansel_next_codepoint(s);
     
     if (b == 0xFC) // center (only one in ANSEL)
-        s->mid = special[b-0xA1]; // if several only keeps one
+        s->mid = ansel_special[b-0xA1]; // if several only keeps one
     else if (b >= 0xF0 && b <= 0xF9) { // low
         if (s->lc < 16) // drop 17th and beyond
-            s->low[(s->lc)++] = special[b-0xA1];
+            s->low[(s->lc)++] = ansel_special[b-0xA1];
     } else { // high
         if (((s->hc1+1)&0xF) != s->hc2) { // drop 16th and beyond
-            s->high[(s->hc1)++] = special[b-0xA1]; s->hc1&=0xF;
+            s->high[(s->hc1)++] = ansel_special[b-0xA1]; s->hc1&=0xF;
         }
     }
     
@@ -68,7 +191,7 @@ int ansel_next_codepoint(DecodingFileReader *s) {
 
 
 int utf8_next_codepoint(DecodingFileReader *s) {
-    int b = fgetc(s->f);
+    int b = decoding_getc(s);
     if (b < 0x80) return b;
     if (b < 0xC0 || b >= 0xF8) return -b; // invalid leader
 
@@ -76,7 +199,7 @@ int utf8_next_codepoint(DecodingFileReader *s) {
     int ans = b & ((1<<(7-more))-1);
 
     for(int i=0; i<more; i+=1) {
-        b = fgetc(s->f);
+        b = decoding_getc(s);
         if (b < 0x80 || b >= 0xC0) return -b;
         ans = (ans<<6) | (b&0x3F);
     }
@@ -94,14 +217,14 @@ int utf8_next_codepoint(DecodingFileReader *s) {
 
 int utf16_next_codepoint(DecodingFileReader *s, int le) {
     int b1,b2;
-    if ((b1 = fgetc(s->f)) < 0) return b1;
-    if ((b2 = fgetc(s->f)) < 0) return b2;
+    if ((b1 = decoding_getc(s)) < 0) return b1;
+    if ((b2 = decoding_getc(s)) < 0) return b2;
     int s1 = le ? ((b2<<8)|b1) : ((b1<<8)|b2);
     if (s1 < 0xD800 || s1 >= 0xE000) return s1;
 
     if (s1 >= 0xDC00) return -s1; // cannot have trailing surrogate first
-    if ((b1 = fgetc(s->f)) < 0) return b1;
-    if ((b2 = fgetc(s->f)) < 0) return b2;
+    if ((b1 = decoding_getc(s)) < 0) return b1;
+    if ((b2 = decoding_getc(s)) < 0) return b2;
     int s2 = le ? ((b2<<8)|b1) : ((b1<<8)|b2);
     if (s2 < 0xDC00 || s2 >= 0xE000) return -s2; // must be trailing surrogate
 
@@ -111,10 +234,10 @@ int utf16_next_codepoint(DecodingFileReader *s, int le) {
 
 int utf32_next_codepoint(DecodingFileReader *s, int le) {
     int b1,b2,b3,b4;
-    if ((b1 = fgetc(s->f)) < 0) return b1;
-    if ((b2 = fgetc(s->f)) < 0) return b2;
-    if ((b3 = fgetc(s->f)) < 0) return b3;
-    if ((b4 = fgetc(s->f)) < 0) return b4;
+    if ((b1 = decoding_getc(s)) < 0) return b1;
+    if ((b2 = decoding_getc(s)) < 0) return b2;
+    if ((b3 = decoding_getc(s)) < 0) return b3;
+    if ((b4 = decoding_getc(s)) < 0) return b4;
     int ans = le ? ((b4<<24)|(b3<<16)|(b2<<8)|b1) 
                  : ((b1<<24)|(b2<<16)|(b3<<8)|b4);
 
@@ -127,52 +250,305 @@ int utf32_next_codepoint(DecodingFileReader *s, int le) {
 
 int nextCodepoint(DecodingFileReader *s) {
     switch(s->format) {
-        case NONE: return fgetc(s->f);
+        case NONE: return decoding_getc(s);
         case ANSEL: return ansel_next_codepoint(s);
         case UTF8: return utf8_next_codepoint(s);
         case UTF16LE: return utf16_next_codepoint(s, 1);
         case UTF16BE: return utf16_next_codepoint(s, 0);
         case UTF32LE: return utf32_next_codepoint(s, 1);
         case UTF32BE: return utf32_next_codepoint(s, 0);
-        case ASCII: return fgetc(s->f);
+        case ASCII: return decoding_getc(s);
     }
+    return EOF;
 }
 
-int nextUTF8byte(DecodingFileReader *s) {
-    if (s->queuesize) return s->queue[--(s->queuesize)];
-    int codepoint = nextCodepoint(s);
-    if (codepoint < (1<<7)) return codepoint;
-    if (codepoint < (1<<11)) {
-        s->queue[s->queuesize++] = (codepoint&0x3F)|0x80;
-        return (codepoint>>6)|0xC0;
+/// writes `codepoint` as UTF-8 at `p`, returning the byte after it
+static inline unsigned char *put_utf8(unsigned char *p, int codepoint) {
+    if (codepoint < (1<<7)) {
+        *p++ = codepoint;
+    } else if (codepoint < (1<<11)) {
+        *p++ = (codepoint>>6)|0xC0;
+        *p++ = (codepoint&0x3F)|0x80;
+    } else if (codepoint < (1<<16)) {
+        *p++ = (codepoint>>12)|0xE0;
+        *p++ = ((codepoint>>6)&0x3F)|0x80;
+        *p++ = (codepoint&0x3F)|0x80;
+    } else {
+        *p++ = (codepoint>>18)|0xF0;
+        *p++ = ((codepoint>>12)&0x3F)|0x80;
+        *p++ = ((codepoint>>6)&0x3F)|0x80;
+        *p++ = (codepoint&0x3F)|0x80;
     }
-    if (codepoint < (1<<16)) {
-        s->queue[s->queuesize++] = (codepoint&0x3F)|0x80;
-        s->queue[s->queuesize++] = ((codepoint>>6)&0x3F)|0x80;
-        return (codepoint>>12)|0xE0;
+    return p;
+}
+
+/**
+ * Returns the length of the longest prefix of p[0..n) that consists
+ * of complete, shortest-form UTF-8 sequences. Such bytes decode and
+ * re-encode to themselves, so they can be passed through unchanged;
+ * anything else is left to utf8_next_codepoint.
+ */
+static size_t utf8_valid_prefix(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for(;;) {
+        i += gedScan_ascii(p+i, n-i);
+        if (i >= n) break;
+        unsigned char b = p[i];
+        if (b < 0xC2 || b > 0xF4) break;
+        size_t more = (b >= 0xE0) + (b >= 0xF0) + 1;
+        if (i + more >= n) break; // incomplete; let the slow path refill
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (b == 0xE0) lo = 0xA0; // overlong
+        else if (b == 0xED) hi = 0x9F; // surrogates
+        else if (b == 0xF0) lo = 0x90; // overlong
+        else if (b == 0xF4) hi = 0x8F; // above 0x10FFFF
+        if (p[i+1] < lo || p[i+1] > hi) break;
+        if (more >= 2 && (p[i+2] & 0xC0) != 0x80) break;
+        if (more >= 3 && (p[i+3] & 0xC0) != 0x80) break;
+        i += more + 1;
     }
-    if (codepoint < (1<<21)) {
-        s->queue[s->queuesize++] = (codepoint&0x3F)|0x80;
-        s->queue[s->queuesize++] = ((codepoint>>6)&0x3F)|0x80;
-        s->queue[s->queuesize++] = ((codepoint>>12)&0x3F)|0x80;
-        return (codepoint>>18)|0xF0;
+    return i;
+}
+
+#ifndef NDEBUG
+/// 1 if `ansel_table` agrees with `ansel_special`
+static int ansel_table_ok() {
+    for(int b=0xA1; b<=0xFF; b+=1) {
+        const struct ansel_char *c = &ansel_table[b];
+        int cp = ansel_special[b-0xA1];
+        if ((cp < 0) != (c->kind == ANSEL_ERROR)) return 0;
+        if (cp < 0) continue;
+        unsigned char buf[4];
+        if (put_utf8(buf, cp) - buf != c->len || memcmp(buf, c->utf8, c->len)) return 0;
+        int kind = b < 0xE0 ? ANSEL_GLYPH : b == 0xFC ? ANSEL_MID 
+            : (b >= 0xF0 && b <= 0xF9) ? ANSEL_LOW : ANSEL_HIGH;
+        if (c->kind != kind) return 0;
     }
-    return -codepoint; // larger than UTF-8 allows
+    return 1;
 }
+#endif
 
+/**
+ * Decodes ANSEL from the buffered input into o..end, returning the
+ * new end of the output. Stops before any byte it cannot finish in
+ * this buffer -- an unmapped byte, or diacritics whose base is not
+ * buffered or not valid -- and leaves those to ansel_next_codepoint.
+ * Must only be called with no diacritics queued.
+ * 
+ * Diacritics come out after their base the way ansel_next_codepoint
+ * orders them: the center one, then the last 16 low ones in input
+ * order, then the last 15 high ones in reverse input order.
+ */
+static unsigned char *ansel_decode_block(DecodingFileReader *s, unsigned char *o, unsigned char *end) {
+    const unsigned char *p = s->in;
+    size_t i = s->inpos, n = s->inlen;
+    while (i < n) {
+        size_t ascii = gedScan_ascii(p+i, n-i);
+        if (ascii > (size_t)(end - o)) ascii = end - o;
+        memcpy(o, p+i, ascii);
+        o += ascii; i += ascii;
+        if (i >= n || end - o < 3) break;
+        
+        const struct ansel_char *c = &ansel_table[p[i]];
+        if (c->kind == ANSEL_GLYPH) {
+            memcpy(o, c->utf8, 3); // len or fewer of these matter
+            o += c->len; i += 1;
+            continue;
+        }
+        if (c->kind == ANSEL_ERROR) break;
+        
+        size_t j = i; // the base follows its diacritics
+        int lows = 0, mid = 0;
+        for(; j < n && ansel_table[p[j]].kind >= ANSEL_HIGH; j += 1) {
+            lows += ansel_table[p[j]].kind == ANSEL_LOW;
+            mid |= ansel_table[p[j]].kind == ANSEL_MID;
+        }
+        if (j >= n) break;
+        if (p[j] >= 0x80 && ansel_table[p[j]].kind != ANSEL_GLYPH) break;
+        if (end - o < 3*(1+1+16+15)) break;
+        
+        if (p[j] < 0x80) *(o++) = p[j];
+        else { memcpy(o, ansel_table[p[j]].utf8, 3); o += ansel_table[p[j]].len; }
+        if (mid) {
+            memcpy(o, ansel_table[0xFC].utf8, 3);
+            o += ansel_table[0xFC].len;
+        }
+        for(size_t k = i; k < j; k += 1) {
+            if (ansel_table[p[k]].kind != ANSEL_LOW) continue;
+            if (lows-- > 16) continue;
+            memcpy(o, ansel_table[p[k]].utf8, 3);
+            o += ansel_table[p[k]].len;
+        }
+        int highs = 0;
+        for(size_t k = j; k > i && highs < 15; k -= 1) {
+            if (ansel_table[p[k-1]].kind != ANSEL_HIGH) continue;
+            memcpy(o, ansel_table[p[k-1]].utf8, 3);
+            o += ansel_table[p[k-1]].len;
+            highs += 1;
+        }
+        i = j+1;
+    }
+    s->inpos = i;
+    return o;
+}
 
-int decodingFileReader_init(DecodingFileReader *s, FILE *in) {
-    s->f = in;
-    s->format = NONE;
-    s->hc1 = s->hc2 = s->lc = s->mid = s->queuesize = 0;
+/**
+ * Decodes UTF-16 from the buffered input into o..end, returning the
+ * new end of the output. Stops before any code unit it cannot finish
+ * in this buffer -- a lone or misordered surrogate, or a unit or pair
+ * split by the end of the buffer -- and leaves those to
+ * utf16_next_codepoint so that errors are reported as before.
+ */
+static unsigned char *utf16_decode_block(DecodingFileReader *s, unsigned char *o, unsigned char *end, int le) {
+    const unsigned char *p = s->in;
+    size_t i = s->inpos, n = s->inlen;
+    int lo = le ? 0 : 1, hi = le ? 1 : 0;
+    while (i + 2 <= n && end - o >= 4) {
+        int u = (p[i+hi]<<8) | p[i+lo];
+#ifdef GED_HAVE_SSE2
+        if (u < 0x80) { // ASCII is common; try 8 code units at a time
+            const __m128i high = _mm_set1_epi16((short)0xFF80);
+            while (i + 16 <= n && end - o >= 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *)(p+i));
+                if (!le) x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+                __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(x, high), _mm_setzero_si128());
+                if (_mm_movemask_epi8(ascii) != 0xFFFF) break;
+                _mm_storel_epi64((__m128i *)o, _mm_packus_epi16(x, x));
+                o += 8; i += 16;
+            }
+            if (i + 2 > n || end - o < 4) break;
+            u = (p[i+hi]<<8) | p[i+lo];
+        }
+#endif
+        if (u < 0xD800 || u >= 0xE000) {
+            o = put_utf8(o, u);
+            i += 2;
+            continue;
+        }
+        if (u >= 0xDC00 || i + 4 > n) break;
+        int u2 = (p[i+2+hi]<<8) | p[i+2+lo];
+        if (u2 < 0xDC00 || u2 >= 0xE000) break;
+        o = put_utf8(o, (((u&0x3FF)<<10) | (u2&0x3FF)) + 0x10000);
+        i += 4;
+    }
+    s->inpos = i;
+    return o;
+}
+
+/// like utf16_decode_block, but for UTF-32
+static unsigned char *utf32_decode_block(DecodingFileReader *s, unsigned char *o, unsigned char *end, int le) {
+    const unsigned char *p = s->in;
+    size_t i = s->inpos, n = s->inlen;
+    while (i + 4 <= n && end - o >= 4) {
+        unsigned long c = le 
+            ? ((unsigned long)p[i+3]<<24) | (p[i+2]<<16) | (p[i+1]<<8) | p[i]
+            : ((unsigned long)p[i]<<24) | (p[i+1]<<16) | (p[i+2]<<8) | p[i+3];
+        if (c >= 0x110000 || (c >= 0xD800 && c < 0xE000)) break;
+        o = put_utf8(o, (int)c);
+        i += 4;
+    }
+    s->inpos = i;
+    return o;
+}
+
+/**
+ * Decodes the next block of input into s->out. Must only be called
+ * once all of s->out has been consumed. Returns the number of decoded
+ * bytes, or a negative number for EOF or an encoding error.
+ */
+static long decoding_fill(DecodingFileReader *s) {
+    if (s->pending) {
+        int ans = s->pending;
+        s->pending = 0;
+        return ans;
+    }
+    s->outpos = s->outlen = 0;
+    
+    // fast path: pass through whatever is already UTF-8
+    if (s->format == UTF8 || s->format == ASCII || s->identity) {
+        if (s->inpos >= s->inlen) decoding_refill(s);
+        const unsigned char *p = s->in + s->inpos;
+        size_t n = s->inlen - s->inpos;
+        if (!s->identity)
+            n = (s->format == UTF8) ? utf8_valid_prefix(p, n) : gedScan_ascii(p, n);
+        if (n) {
+            s->out = s->in + s->inpos;
+            s->outlen = n;
+            s->inpos += n;
+            return n;
+        }
+    }
+    
+    s->out = s->outbuf;
+    unsigned char *o = s->outbuf;
+    unsigned char *end = s->outbuf + DECODING_BLOCK_SIZE - 4;
     
+    // fast paths: decode whole buffers at once
+    if (s->inpos >= s->inlen) decoding_refill(s);
+    switch(s->format) {
+        case ANSEL:
+            if (!s->mid && !s->lc && s->hc1 == s->hc2)
+                o = ansel_decode_block(s, o, end);
+            break;
+        case UTF16LE: o = utf16_decode_block(s, o, end, 1); break;
+        case UTF16BE: o = utf16_decode_block(s, o, end, 0); break;
+        case UTF32LE: o = utf32_decode_block(s, o, end, 1); break;
+        case UTF32BE: o = utf32_decode_block(s, o, end, 0); break;
+        default: break;
+    }
+    if (o > s->outbuf) {
+        s->outlen = o - s->outbuf;
+        return s->outlen;
+    }
+
+    for(;;) {
+        int codepoint = nextCodepoint(s);
+        if (codepoint == EOF) codepoint = s->end;
+        if (codepoint < 0) {
+            if (o == s->outbuf) return codepoint;
+            s->pending = codepoint;
+            break;
+        }
+        o = put_utf8(o, codepoint);
+        // only ANSEL's diacritic queues need more of this loop than one
+        // code point before the fast paths can take over again
+        if (o >= end || (!s->mid && !s->lc && s->hc1 == s->hc2)) break;
+    }
+    s->outlen = o - s->outbuf;
+    return s->outlen;
+}
+
+int nextUTF8byte(DecodingFileReader *s) {
+    if (s->outpos < s->outlen) return s->out[s->outpos++];
+    long n = decoding_fill(s);
+    if (n < 0) return n;
+    return s->out[s->outpos++];
+}
+
+long nextUTF8span(DecodingFileReader *s, const char **span) {
+    if (s->outpos >= s->outlen) {
+        long n = decoding_fill(s);
+        if (n < 0) return n;
+    }
+    *span = (const char *)s->out + s->outpos;
+    return s->outlen - s->outpos;
+}
+
+void decodingFileReader_skip(DecodingFileReader *s, size_t n) {
+    s->outpos += n;
+}
+
+
+/**
+ * The part of decodingFileReader_init that detects the encoding. Reads
+ * at least through HEAD.CHAR, all of which remains buffered in s->in.
+ */
+static int decodingFileReader_sniff(DecodingFileReader *s) {
     // detected character encoding based on first 4 bytes
-    unsigned char check[4];
+    decoding_refill(s);
+    if (s->inlen < 4) return 4; // empty file
+    const unsigned char *check = s->in;
     int bom = 0;
-    if (fread(check, 1, 4, in) != 4) { 
-        fprintf(stderr, "ERROR: empty file\n");
-        return 4;
-    }
     if (check[0] == 0xef && check[1] == 0xbb && check[2] == 0xbf) {
         s->format = UTF8;
         bom = 3;
@@ -199,16 +575,16 @@ int decodingFileReader_init(DecodingFileReader *s, FILE *in) {
         bom = 0;
     }
     //fprintf(stderr, "Detected character encoding: %s (%s BOM)\n", codec_names[s->format], bom ? "with" : "without");
+    s->bom = bom;
     
     // use detected character encoding to look for CHAR tag in HEAD
-    fseek(in, bom, SEEK_SET);
-    s->hc1 = s->hc2 = s->lc = s->mid = s->queuesize = 0;
+    decoding_seek(s, bom);
     // the rule is /[\n\r][ \t]*1[ \t]+CHAR[ \t]+([^\n]*)/
     // between first and second /([\n\r]|^)0/
     /* Step Meaning
      * 0    before '0 HEAD'
      * 1    inside non-CHAR line
-     * 2    past line break
+     * 2    past line break and any indentation
      * 3    [\n\r]1
      * 4    [\n\r]1[ \t]+
      * 5    [\n\r]1[ \t]+C
@@ -223,24 +599,18 @@ int decodingFileReader_init(DecodingFileReader *s, FILE *in) {
     specified_encoding[0] = 0;
     while(step != 2 || octet != '0') {
         octet = nextUTF8byte(s);
-        if (octet == -1) {
-            fprintf(stderr, "GEDCOM file ended while still inside HEAD\n");
-            return 1; // not GEDCOM: file ended inside HEAD
-        }
+        if (octet == -1) return 1; // not GEDCOM: file ended inside HEAD
         switch(step) {
             case 0: {
                 if (isspace(octet)) {}
                 else if (octet == '0') { step = 1; }
-                else {
-                    fprintf(stderr, "GEDCOM file began with U+%04X '%c', not with '0'\n", octet, octet);
-                    return 2; 
-                }
+                else return 2; // not GEDCOM: began with something other than '0'
             } break;
             case 1: {
                 if (octet == '\n' || octet == '\r') step = 2;
             } break;
-            case 2: {
-                if (octet == '\n' || octet == '\r') step = 2;
+            case 2: { // the parser allows indented lines, so skip that too
+                if (octet == '\n' || octet == '\r' || octet == ' ' || octet == '\t') step = 2;
                 else if (octet == '0') step = 10;
                 else if (octet == '1') step = 3;
                 else step = 1;
@@ -303,47 +673,215 @@ int decodingFileReader_init(DecodingFileReader *s, FILE *in) {
         if (s->format == NONE) s->format = UTF8; // non-standard use
         // standard cases (UTF16LE and UTF16BE) already detected
     } else {
-        fprintf(stderr, "Unexpected encoding %s\n", specified_encoding);
         return 3; // unsupported character encoding
     }
     
     // QUESTION: is ANSEL the right default?
     if (s->format == NONE) s->format = UTF8; 
     
-    fseek(in, bom, SEEK_SET);
-    s->hc1 = s->hc2 = s->lc = s->mid = s->queuesize = 0;
     return 0;
 }
 
+/// shared by all decodingFileReader_init* once `in` and `f` are set
+static int decodingFileReader_start(DecodingFileReader *s) {
+    assert(ansel_table_ok()); // catch edits made to only one of them
+    s->format = NONE;
+    s->identity = 0;
+    s->end = EOF;
+    s->outbuf = malloc(DECODING_BLOCK_SIZE);
+    s->inbase = s->bom = 0;
+    s->inpos = 0;
+    decoding_seek(s, 0);
+    
+    s->sniffing = 1;
+    int status = decodingFileReader_sniff(s);
+    s->sniffing = 0;
+    if (status) return status;
+    
+    // 8-bit codecs are often declared for all-ASCII input; if the whole
+    // input is at hand, check once and skip decoding if so
+    if (!s->f && (s->format == ANSEL || s->format == ASCII)
+    && gedScan_ascii(s->in + s->bom, s->inlen - s->bom) == s->inlen - s->bom)
+        s->identity = 1;
+    
+    decoding_seek(s, s->bom);
+    return 0;
+}
+
+const char *decodingFileReader_error(int status) {
+    switch(status) {
+        case 0: return 0;
+        case 1: return "GEDCOM file ended while still inside HEAD";
+        case 2: return "GEDCOM file did not begin with '0'";
+        case 3: return "Unsupported character encoding in HEAD.CHAR";
+        case 4: return "Empty file";
+        default: return "Unable to read the file";
+    }
+}
+
+int decodingFileReader_init(DecodingFileReader *s, FILE *in) {
+    s->f = in;
+    s->mapped = 0;
+    s->incap = DECODING_BLOCK_SIZE;
+    s->in = malloc(s->incap);
+    s->inlen = 0;
+    return decodingFileReader_start(s);
+}
+
+int decodingFileReader_initMemory(DecodingFileReader *s, const void *data, size_t len) {
+    s->f = 0;
+    s->mapped = 1;
+    s->in = (unsigned char *)data; // never written through
+    s->incap = s->inlen = len;
+    return decodingFileReader_start(s);
+}
+
+int decodingFileReader_initUTF8(DecodingFileReader *s, const void *data, size_t len, int end) {
+    s->f = 0;
+    s->mapped = 1;
+    s->in = (unsigned char *)data; // never written through
+    s->incap = s->inlen = len;
+    s->format = UTF8;
+    s->identity = 0;
+    s->end = end;
+    s->outbuf = malloc(DECODING_BLOCK_SIZE);
+    s->inbase = s->bom = 0;
+    s->inpos = 0;
+    decoding_seek(s, 0);
+    return 0;
+}
+
+int decodingFileReader_initMapped(DecodingFileReader *s, FILE *in) {
+    void *data;
+    size_t len;
+#ifdef _WIN32
+    HANDLE fh = (HANDLE)_get_osfhandle(_fileno(in));
+    LARGE_INTEGER size;
+    if (fh == INVALID_HANDLE_VALUE || !GetFileSizeEx(fh, &size)) return -1;
+    if (size.QuadPart <= 0 || (unsigned long long)size.QuadPart > (size_t)-1) return -1;
+    HANDLE map = CreateFileMapping(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!map) return -1;
+    data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(map); // the view keeps the mapping alive
+    if (!data) return -1;
+    len = (size_t)size.QuadPart;
+#elif defined(GED_HAVE_MMAP)
+    struct stat st;
+    if (fstat(fileno(in), &st) || !S_ISREG(st.st_mode)) return -1;
+    if (st.st_size <= 0 || (unsigned long long)st.st_size > (size_t)-1) return -1;
+    len = (size_t)st.st_size;
+    data = mmap(0, len, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+    if (data == MAP_FAILED) return -1;
+    posix_madvise(data, len, POSIX_MADV_SEQUENTIAL);
+#else
+    return -1;
+#endif
+    int status = decodingFileReader_initMemory(s, data, len);
+    s->mapped = 2;
+    return status;
+}
+
 void decodingFileReader_rewind(DecodingFileReader *s) {
-    int bom = 0;
+    decoding_seek(s, s->bom);
+}
 
-    fseek(s->f, bom, SEEK_SET);
-    
-    // detected character encoding based on first 4 bytes
-    unsigned char check[4];
-    if (fread(check, 1, 4, s->f) != 4) { 
-        fseek(s->f, bom, SEEK_SET);
-        return;
+int decodingFileReader_canRewind(DecodingFileReader *s) {
+    return !s->f || decoding_ftell(s->f) >= 0;
+}
+
+/// SHA-256 (FIPS 180-4) of bytes given to it in any number of pieces
+struct decoding_hash {
+    uint32_t h[8];
+    unsigned long long len;
+    unsigned char tail[64]; // bytes past the last whole block
+};
+static const uint32_t decoding_hash_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+#define DECODING_ROTR(x, n) (((x) >> (n)) | ((x) << (32-(n))))
+static void decoding_hash_block(struct decoding_hash *d, const unsigned char *p) {
+    uint32_t w[64], v[8];
+    for(int i=0; i<16; i+=1)
+        w[i] = ((uint32_t)p[4*i]<<24) | ((uint32_t)p[4*i+1]<<16) | ((uint32_t)p[4*i+2]<<8) | p[4*i+3];
+    for(int i=16; i<64; i+=1)
+        w[i] = w[i-16] + w[i-7]
+            + (DECODING_ROTR(w[i-15], 7) ^ DECODING_ROTR(w[i-15], 18) ^ (w[i-15] >> 3))
+            + (DECODING_ROTR(w[i-2], 17) ^ DECODING_ROTR(w[i-2], 19) ^ (w[i-2] >> 10));
+    memcpy(v, d->h, sizeof(v));
+    for(int i=0; i<64; i+=1) {
+        uint32_t t1 = v[7] + (DECODING_ROTR(v[4], 6) ^ DECODING_ROTR(v[4], 11) ^ DECODING_ROTR(v[4], 25))
+            + ((v[4] & v[5]) ^ (~v[4] & v[6])) + decoding_hash_k[i] + w[i];
+        uint32_t t2 = (DECODING_ROTR(v[0], 2) ^ DECODING_ROTR(v[0], 13) ^ DECODING_ROTR(v[0], 22))
+            + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v+1, v, 7*sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + t2;
     }
-    if (check[0] == 0xef && check[1] == 0xbb && check[2] == 0xbf) {
-        bom = 3;
-    } else if (check[0] == 0xFF && check[1] == 0xFE) {
-        bom = (check[2] || check[3]) ? 2 : 4;
-    } else if (check[0] == 0xFE && check[1] == 0xFF) {
-        bom = 2;
-    } else if (!check[0] && !check[1] && check[2] == 0xFF && check[3] == 0xFE) {
-        bom = 4;
-    } else if (check[0] && !check[1] && !check[2] && !check[3]) {
-        bom = 0;
-    } else if (!check[0] && !check[1] && !check[2] && check[3]) {
-        bom = 0;
-    } else if (check[0] && !check[1]) {
-        bom = 0;
-    } else if (!check[0] && check[1]) {
-        bom = 0;
+    for(int i=0; i<8; i+=1) d->h[i] += v[i];
+}
+#undef DECODING_ROTR
+static void decoding_hash_add(struct decoding_hash *d, const unsigned char *p, size_t n) {
+    size_t used = d->len % 64;
+    d->len += n;
+    if (used) {
+        size_t take = n < 64-used ? n : 64-used;
+        memcpy(d->tail + used, p, take);
+        p += take; n -= take;
+        if (used + take < 64) return;
+        decoding_hash_block(d, d->tail);
+    }
+    for(; n >= 64; p += 64, n -= 64) decoding_hash_block(d, p);
+    memcpy(d->tail, p, n);
+}
+static void decoding_hash_finish(struct decoding_hash *d, unsigned char digest[32]) {
+    size_t used = d->len % 64;
+    d->tail[used++] = 0x80;
+    if (used > 56) {
+        memset(d->tail + used, 0, 64 - used);
+        decoding_hash_block(d, d->tail);
+        used = 0;
     }
+    memset(d->tail + used, 0, 56 - used);
+    for(int i=0; i<8; i+=1) d->tail[56+i] = (unsigned char)((d->len*8) >> (56 - 8*i));
+    decoding_hash_block(d, d->tail);
+    for(int i=0; i<32; i+=1) digest[i] = (unsigned char)(d->h[i/4] >> (24 - 8*(i%4)));
+}
+
+int decodingFileReader_hash(DecodingFileReader *s, unsigned char digest[32], unsigned long long *len) {
+    struct decoding_hash d = {{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}, 0, {0}};
+    if (!s->f) {
+        decoding_hash_add(&d, s->in, s->inlen);
+    } else {
+        int64_t pos = decoding_ftell(s->f);
+        if (pos < 0 || decoding_fseek(s->f, 0)) return 1;
+        unsigned char *buf = malloc(DECODING_BLOCK_SIZE);
+        size_t got;
+        while ((got = fread(buf, 1, DECODING_BLOCK_SIZE, s->f)) > 0)
+            decoding_hash_add(&d, buf, got);
+        free(buf);
+        clearerr(s->f);
+        decoding_fseek(s->f, pos);
+    }
+    *len = d.len;
+    decoding_hash_finish(&d, digest);
+    return 0;
+}
 
-    fseek(s->f, bom, SEEK_SET);
-    s->hc1 = s->hc2 = s->lc = s->mid = s->queuesize = 0;
+void decodingFileReader_destroy(DecodingFileReader *s) {
+    if (s->mapped == 0) free(s->in);
+#ifdef _WIN32
+    if (s->mapped == 2) UnmapViewOfFile(s->in);
+#elif defined(GED_HAVE_MMAP)
+    if (s->mapped == 2) munmap(s->in, s->incap);
+#endif
+    free(s->outbuf);
+    s->in = s->outbuf = 0;
+    s->out = 0;
 }
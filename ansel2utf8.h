@@ -21,10 +21,14 @@
  * This code is knowing and willfully released to the public domain 
  * by its author and may be used in whole or in part, with or without
  * attribution, for any purpose without requiring any additional
- * permission, payment, notification, or other action.
+ * permission, payment, notification, or other action. Later changes
+ * by the project's other contributors are released on the same terms.
  */
+#pragma once
 
 #include <stdio.h>  // FILE*
+#include <stddef.h> // size_t
+#include <stdint.h> // int64_t
 
 /** Character encodings known to this implementation */
 typedef enum { NONE, ANSEL, UTF8, UTF16LE, UTF16BE, UTF32LE, UTF32BE, ASCII } Codec;
@@ -35,21 +39,44 @@ typedef enum { NONE, ANSEL, UTF8, UTF16LE, UTF16BE, UTF32LE, UTF32BE, ASCII } Co
  */
 extern const char *codec_names[];
 
+/** Bytes of raw input read from the file at a time */
+#define DECODING_BLOCK_SIZE (1<<16)
+
 /**
  * A stateful wrapper is needed to parse some codecs because of 
  * multibyte characters, diacritic reordering, etc.
+ * 
+ * Input is read from `f` a block at a time into `in`, and decoded a 
+ * block at a time into UTF-8. Decoded bytes `out[outpos..outlen)` 
+ * have not yet been consumed; `out` is either `outbuf` or, when the
+ * input is already valid UTF-8 (including ASCII runs of ASCII input),
+ * points directly into `in`.
+ * 
+ * If `f` is NULL the entire input is already in `in` (see `mapped`)
+ * and is never refilled; rewinding just resets `inpos`.
  */
 typedef struct {
     FILE *f;
     Codec format;
     
+    // raw input: in[inpos..inlen) not yet decoded; in[0] is at file
+    // offset inbase; bom is the offset of the first post-BOM byte
+    unsigned char *in; size_t inpos, inlen, incap;
+    int64_t inbase, bom;
+    int sniffing; // if nonzero, grow `in` instead of discarding it
+    int mapped; // 0: `in` malloced; 1: caller's memory; 2: mapped file
+    int identity; // if nonzero, all of `in` is ASCII so is its own UTF-8
+    
+    // decoded UTF-8 output
+    const unsigned char *out; size_t outpos, outlen;
+    unsigned char *outbuf;
+    int pending; // 0, or a negative value to report once out is empty
+    int end; // reported instead of EOF when the input runs out
+    
     // state for ANSEL-to-Unicode diacritic reordering
     int high[16]; int hc1; int hc2; // circular queue
     int low[16]; int lc; // stack
     int mid; // 0 (none) or 0x388 (combining long solidus overlay)
-    
-    // state for codepoint-to-UTF-8 serializing
-    unsigned char queue[3]; int queuesize;
 
 } DecodingFileReader;
 
@@ -94,6 +121,8 @@ int utf32_next_codepoint(DecodingFileReader *s, int le);
  * Returns the next byte for ASCII or NONE.
  * 
  * Intended for internal use, but potentially useful for some APIs.
+ * Reads directly from the raw input, so must not be mixed with
+ * `nextUTF8byte` or `nextUTF8span` on the same reader.
  */
 int nextCodepoint(DecodingFileReader *s);
 
@@ -105,11 +134,25 @@ int nextCodepoint(DecodingFileReader *s);
  */
 int nextUTF8byte(DecodingFileReader *);
 
+/**
+ * Bulk version of `nextUTF8byte`: decodes input if needed, points 
+ * `*span` at the decoded-but-unconsumed UTF-8 bytes and returns how
+ * many there are. The bytes stay valid until the next call on `s`;
+ * they are not consumed until `decodingFileReader_skip` is called.
+ * 
+ * Negative numbers indicate EOF (-1) or encoding error (<-1), in which
+ * case that EOF or error is consumed as `nextUTF8byte` would have.
+ */
+long nextUTF8span(DecodingFileReader *s, const char **span);
+
+/** Consumes `n` bytes of the span most recently returned by `nextUTF8span` */
+void decodingFileReader_skip(DecodingFileReader *s, size_t n);
+
 /**
  * Initializes `s` to a new decoding file reader for `f`,
  * which must be a seekable file opened for reading.
  * Performs character detection and looks for HEAD.CHAR to back that up.
- * `fseek`s the file pointer to the first post-BOM character.
+ * Positions the reader at the first post-BOM character.
  * When complete, `s` is ready for calls to `nextUTF8Byte`.
  * 
  * Returns 0 on success, nonzero if unable to parse enough GEDCOM 
@@ -117,8 +160,53 @@ int nextUTF8byte(DecodingFileReader *);
  */
 int decodingFileReader_init(DecodingFileReader *s, FILE *in);
 
+/**
+ * A description of what a nonzero status returned by
+ * `decodingFileReader_init` (or its variants) means, or NULL for 0.
+ */
+const char *decodingFileReader_error(int status);
+
+/**
+ * Like `decodingFileReader_init`, but maps all of `in` into memory so 
+ * that decoding reads the mapped pages directly with no read calls or
+ * copies into stdio buffers, and rewinding costs nothing.
+ * 
+ * Returns -1, leaving `s` uninitialized, if `in` cannot be mapped (for
+ * example, it is a pipe, is empty, or the platform lacks mapping);
+ * otherwise returns the same as `decodingFileReader_init`.
+ */
+int decodingFileReader_initMapped(DecodingFileReader *s, FILE *in);
+
+/**
+ * Like `decodingFileReader_init`, but decodes `len` bytes at `data`,
+ * which must remain valid and unchanged until `s` is destroyed.
+ */
+int decodingFileReader_initMemory(DecodingFileReader *s, const void *data, size_t len);
+
+/**
+ * Reads `len` bytes at `data` as UTF-8 without detecting the encoding,
+ * for text that is a later part of an already-decoded input. When the
+ * text runs out, reports `end` instead of EOF; pass EOF, or the error
+ * the text was cut short by. `data` must outlive `s`.
+ */
+int decodingFileReader_initUTF8(DecodingFileReader *s, const void *data, size_t len, int end);
+
 /**
  * Rewind so the next character returned is the fist character,
  * of the first character after the BOM if present.
  */
 void decodingFileReader_rewind(DecodingFileReader *s);
+
+/** 1 if `decodingFileReader_rewind` works on `s`; 0 for pipes and the like */
+int decodingFileReader_canRewind(DecodingFileReader *s);
+
+/**
+ * Hashes all of the raw (not yet decoded) input of `s`, putting the
+ * SHA-256 of its bytes in `digest` and its length in `*len`, without
+ * changing what `s` reads next. Returns 0, or nonzero if the input
+ * cannot be read again (see `decodingFileReader_canRewind`).
+ */
+int decodingFileReader_hash(DecodingFileReader *s, unsigned char digest[32], unsigned long long *len);
+
+/** Frees the buffers or mapping made by `decodingFileReader_init*` (but not `s`) */
+void decodingFileReader_destroy(DecodingFileReader *s);
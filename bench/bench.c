@@ -0,0 +1,128 @@
+/**
+ * Times the converter on each file given, printing JSON to stdout:
+ *
+ * USAGE: bench [-n repeats] file.ged...
+ *
+ * For each file it reports
+ *
+ * - "parse": decoding and parsing alone (`gedEventSource_get`)
+ * - "convert": all of `ged551to700_memory`, with output discarded
+ * - "stages": what each filter did in one more conversion, as reported
+ *   by `GedOptions.profile`
+ *
+ * with the first two as seconds, MB/s, and records/s, taking the
+ * fastest of `repeats` runs (default 3). Input is read into memory
+ * first, so no time is spent waiting on the disk.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h> // for malloc, free, and atoi
+#include <string.h> // for strcmp
+#include <time.h>   // for timespec_get
+#include "../ged_ebp.h"
+#include "../ged_ebp_parse.h"
+
+
+static double bench_now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_discard(const char *bytes, size_t len, void *total) {
+    *(size_t *)total += len;
+}
+
+/// parses all of `data`, counting records and events
+static double bench_parse(const char *data, size_t len, size_t *records, size_t *events) {
+    double t0 = bench_now();
+    GedEventSourceState *src = gedEventSource_createMemory(data, len);
+    int depth = 0;
+    *records = *events = 0;
+    for(;;) {
+        GedEvent e = gedEventSource_get(src);
+        if (e.type == GED_EOF || e.type == GED_ERROR) break;
+        *events += 1;
+        if (e.type == GED_START && depth++ == 0) *records += 1;
+        if (e.type == GED_END) depth -= 1;
+    }
+    gedEventSource_free(src);
+    return bench_now() - t0;
+}
+
+/// prints `s` as a JSON string
+static void bench_json_string(const char *s) {
+    putchar('"');
+    for(; *s; s+=1) {
+        if (*s == '"' || *s == '\\') putchar('\\');
+        if ((unsigned char)*s < 0x20) printf("\\u%04x", *s);
+        else putchar(*s);
+    }
+    putchar('"');
+}
+
+static void bench_json_rate(double seconds, size_t bytes, size_t records) {
+    printf("{\"seconds\": %.6f, \"MB_per_s\": %.2f, \"records_per_s\": %.0f}",
+        seconds, seconds > 0 ? bytes / seconds / 1e6 : 0.0,
+        seconds > 0 ? records / seconds : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    int repeats = 3;
+    int first = 1;
+    printf("[");
+    for(int i=1; i<argc; i+=1) {
+        if (!strcmp("-n", argv[i]) && i+1 < argc) {
+            repeats = atoi(argv[++i]);
+            if (repeats < 1) repeats = 1;
+            continue;
+        }
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) {
+            fprintf(stderr, "ERROR: unable to read from %s\n", argv[i]);
+            return 2;
+        }
+        fseek(f, 0, SEEK_END);
+        size_t len = (size_t)ftell(f);
+        rewind(f);
+        char *data = malloc(len ? len : 1);
+        len = fread(data, 1, len, f);
+        fclose(f);
+
+        size_t records, events, out = 0;
+        double parse = 0, convert = 0;
+        for(int r=0; r<repeats; r+=1) {
+            double t = bench_parse(data, len, &records, &events);
+            if (!r || t < parse) parse = t;
+        }
+        for(int r=0; r<repeats; r+=1) {
+            out = 0;
+            double t0 = bench_now();
+            ged551to700_memory(data, len, bench_discard, &out, 0);
+            double t = bench_now() - t0;
+            if (!r || t < convert) convert = t;
+        }
+
+        printf("%s\n  {\"file\": ", first ? "" : ",");
+        bench_json_string(argv[i]);
+        printf(", \"bytes\": %zu, \"records\": %zu, \"events\": %zu, \"output_bytes\": %zu,\n", len, records, events, out);
+        printf("   \"parse\": ");
+        bench_json_rate(parse, len, records);
+        printf(",\n   \"convert\": ");
+        bench_json_rate(convert, len, records);
+        printf(",\n   \"stages\": ");
+        fflush(stdout);
+        GedOptions options = {0};
+        options.profile = stdout;
+        out = 0;
+        ged551to700_memory(data, len, bench_discard, &out, &options);
+        printf("  }");
+        first = 0;
+        free(data);
+    }
+    printf("\n]\n");
+    return 0;
+}
@@ -0,0 +1,365 @@
+/**
+ * Writes a synthetic GEDCOM 5.5.1 file for benchmarking.
+ *
+ * USAGE: gengedcom [-s bytes] [-e encoding] [-r seed] > out.ged
+ *
+ * where encoding is one of utf8 (the default), ansel, utf16le, or
+ * utf16be. Output stops at the first record boundary after about
+ * `bytes` bytes (default 8000000).
+ *
+ * The content is meant to exercise every filter the way real files
+ * from assorted genealogy programs do: accented names, CONC/CONT-heavy
+ * notes, dual-year and phrase dates, ages in words, inline SOUR and
+ * OBJE structures, Windows file paths, tags and enumerations in odd case,
+ * language names, extension tags, and cross-reference identifiers that
+ * are not legal in 7.0. The same seed always gives the same file.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h> // for atol and strtoul
+#include <string.h> // for strcmp and strlen
+#include <stdarg.h> // for va_list
+
+typedef enum { GEN_UTF8, GEN_ANSEL, GEN_UTF16LE, GEN_UTF16BE } GenEncoding;
+
+typedef struct {
+    GenEncoding enc;
+    unsigned long long rng;
+    long written; // bytes so far
+    int people, families, sources, notes; // records so far
+} Gen;
+
+
+/// xorshift64*
+static unsigned gen_rand(Gen *g, unsigned n) {
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return (unsigned)((g->rng * 2685821657736338717ull) >> 33) % n;
+}
+#define PICK(g, arr) ((arr)[gen_rand((g), sizeof(arr)/sizeof((arr)[0]))])
+
+
+/// ANSEL bytes for the combining marks and letters used below
+static int gen_ansel_mark(int cp) {
+    switch(cp) {
+        case 0x300: return 0xE1; case 0x301: return 0xE2; case 0x302: return 0xE3;
+        case 0x303: return 0xE4; case 0x308: return 0xE8; case 0x30A: return 0xEA;
+        case 0x327: return 0xF0;
+    }
+    return 0;
+}
+static int gen_ansel_glyph(int cp) {
+    switch(cp) {
+        case 0x141: return 0xA1; case 0xD8: return 0xA2; case 0xC6: return 0xA5;
+        case 0x142: return 0xB1; case 0xF8: return 0xB2; case 0xE6: return 0xB5;
+        case 0xDF: return 0xCF;
+    }
+    return '?';
+}
+
+/// the code point at `*s`, advancing `*s` past it
+static int gen_utf8_next(const unsigned char **s) {
+    const unsigned char *p = *s;
+    int cp;
+    if (p[0] < 0x80) { cp = p[0]; *s = p+1; }
+    else if (p[0] < 0xE0) { cp = ((p[0]&0x1F)<<6) | (p[1]&0x3F); *s = p+2; }
+    else { cp = ((p[0]&0x0F)<<12) | ((p[1]&0x3F)<<6) | (p[2]&0x3F); *s = p+3; }
+    return cp;
+}
+
+/// writes `line` (UTF-8, with decomposed accents) and a line break
+static void gen_put(Gen *g, const char *line) {
+    unsigned char buf[4096];
+    size_t n = 0;
+    const unsigned char *s = (const unsigned char *)line;
+    const char *endl = g->enc == GEN_ANSEL ? "\r\n" : "\n";
+    if (g->enc == GEN_UTF8) {
+        fputs(line, stdout);
+        fputs(endl, stdout);
+        g->written += strlen(line) + strlen(endl);
+        return;
+    }
+    while (*s || *endl) {
+        int cp = *s ? gen_utf8_next(&s) : (unsigned char)*(endl++);
+        if (g->enc == GEN_ANSEL) {
+            if (cp < 0x80) {
+                // combining marks follow their base in Unicode, precede it in ANSEL
+                const unsigned char *t = s;
+                while (*t && gen_ansel_mark(gen_utf8_next(&t))) {
+                    const unsigned char *u = s;
+                    buf[n++] = gen_ansel_mark(gen_utf8_next(&u));
+                    s = u;
+                }
+                buf[n++] = cp;
+            } else buf[n++] = gen_ansel_glyph(cp);
+        } else if (g->enc == GEN_UTF16LE) {
+            buf[n++] = cp & 0xFF; buf[n++] = cp >> 8;
+        } else {
+            buf[n++] = cp >> 8; buf[n++] = cp & 0xFF;
+        }
+    }
+    fwrite(buf, 1, n, stdout);
+    g->written += n;
+}
+
+/// formats and writes one line
+static void gen_line(Gen *g, const char *fmt, ...) {
+    char line[2048];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    gen_put(g, line);
+}
+
+
+static const char *const gen_given[] = {
+    "John", "Mary", "William", "Elizabeth", "James", "Sarah", "Thomas",
+    "Anna", "Johann", "Maria", "Pierre", "Marie", "Rene\xCC\x81", "Zoe\xCC\x88",
+    "Bjo\xCC\x88rn", "Franc\xCC\xA7ois", "Jose\xCC\x81", "\xC5\x81ucja",
+    "Sta\xC5\x82" "a", "Hannah", "Jakob", "Ingrid", "Margarethe",
+};
+static const char *const gen_surname[] = {
+    "Smith", "Jones", "Brown", "Miller", "Mu\xCC\x88ller", "Nun\xCC\x83" "ez",
+    "\xC3\x98stergaard", "A\xCC\x8Angstro\xCC\x88m", "Schmidt", "Garci\xCC\x81" "a",
+    "Tychonievich", "O'Brien", "van der Berg", "Strau\xC3\x9F", "Dupont",
+    "L\xC3\xA6rke",
+};
+static const char *const gen_place[] = {
+    "Boston, Suffolk, Massachusetts, USA", "Mu\xCC\x88nchen, Bayern, Deutschland",
+    "Krako\xCC\x81w, Ma\xC5\x82opolskie, Poland", "Paris, Seine, France",
+    ", , Virginia, USA", "London, England", "Sa\xCC\x83o Paulo, Brasil",
+    "\xC3\x98rsta, M\xC3\xB8re og Romsdal, Norway",
+};
+static const char *const gen_month[] = {
+    "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT",
+    "NOV", "DEC",
+};
+static const char *const gen_word[] = {
+    "the", "of", "and", "in", "a", "to", "was", "born", "family", "farm",
+    "church", "records", "said", "his", "her", "parish", "emigrated",
+    "married", "daughter", "son", "according", "letter", "census",
+    "unclear", "possibly", "transcribed", "from", "register", "baptism",
+    "Mu\xCC\x88nster", "witnesses", "godparents", "estate", "will",
+};
+static const char *const gen_lang[] = {
+    "English", "German", "French", "Spanish", "Norwegian", "Polish",
+    "Latin", "Dutch", "Klingon",
+};
+
+/**
+ * The xref of the `n`th record of kind `c`, mostly in the usual style
+ * but sometimes in styles that have to be changed for 7.0
+ */
+static const char *gen_xref(char c, int n, char *buf) {
+    switch(n % 23) {
+        case 3: sprintf(buf, "@%c%d.%d@", c, n/10, n%10); break;
+        case 7: sprintf(buf, "@%c%d@", c - 'A' + 'a', n); break;
+        case 11: sprintf(buf, "@X%d@", n); break;
+        case 17: sprintf(buf, "@%c-%d@", c, n); break;
+        default: sprintf(buf, "@%c%d@", c, n); break;
+    }
+    return buf;
+}
+
+static void gen_date(Gen *g, int level, int year) {
+    const char *mon = PICK(g, gen_month);
+    int day = 1 + gen_rand(g, 28);
+    switch(gen_rand(g, 12)) {
+        case 0: gen_line(g, "%d DATE ABT %d", level, year); break;
+        case 1: gen_line(g, "%d DATE BET %d AND %d", level, year, year+2); break;
+        case 2: gen_line(g, "%d DATE %d %s %d/%02d", level, day, mon, year, (year+1)%100); break;
+        case 3: gen_line(g, "%d DATE @#DJULIAN@ %d %s %d", level, day, mon, year); break;
+        case 4: gen_line(g, "%d DATE (about the time of the war)", level); break;
+        case 5: gen_line(g, "%d DATE INT %d %s %d (from a letter)", level, day, mon, year); break;
+        case 6: gen_line(g, "%d DATE %d/%d", level, year, (year+1)%10); break;
+        case 7: gen_line(g, "%d DATE BEF %s %d", level, mon, year); break;
+        default: gen_line(g, "%d DATE %d %s %d", level, day, mon, year); break;
+    }
+}
+
+/// a text payload of about `len` bytes, split into CONC and CONT lines
+static void gen_text(Gen *g, int level, const char *tag, int len) {
+    char line[512];
+    int n = 0, first = 1, cont = 0;
+    while (len > 0 || n) {
+        const char *w = PICK(g, gen_word);
+        if (len > 0 && n + strlen(w) + 1 < sizeof(line)) {
+            n += sprintf(line + n, "%s%s", n ? " " : "", w);
+            len -= strlen(w) + 1;
+        }
+        // break after 60 to 240 bytes, sometimes mid-word, or at the end
+        if (n > 60 + (int)gen_rand(g, 180) || len <= 0) {
+            int keep = n;
+            if (len > 0 && gen_rand(g, 3) == 0) keep = n - 2;
+            char rest[512];
+            strcpy(rest, line + keep);
+            line[keep] = 0;
+            if (first) gen_line(g, "%d %s %s", level, tag, line);
+            else gen_line(g, "%d %s %s", level+1, cont ? "CONT" : "CONC", line);
+            first = 0;
+            cont = gen_rand(g, 8) == 0;
+            n = sprintf(line, "%s", rest);
+            if (len <= 0 && !n) break;
+        }
+    }
+}
+
+static void gen_event(Gen *g, const char *tag, int year) {
+    char buf[64];
+    gen_line(g, "1 %s", tag);
+    gen_date(g, 2, year);
+    gen_line(g, "2 PLAC %s", PICK(g, gen_place));
+    if (gen_rand(g, 4) == 0) gen_line(g, "2 AGE %s", PICK(g, ((const char *const[]){
+        "72", "34y 2m", "INFANT", "CHILD", "stillborn", "< 8", "3m 4d", ">60y"})));
+    if (gen_rand(g, 3) == 0) { // inline source
+        gen_text(g, 2, "SOUR", 40 + gen_rand(g, 200));
+        gen_line(g, "3 PAGE %d", 1 + gen_rand(g, 400));
+    } else if (g->sources && gen_rand(g, 2) == 0) {
+        gen_line(g, "2 SOUR %s", gen_xref('S', 1 + gen_rand(g, g->sources), buf));
+        gen_line(g, "3 PAGE p. %d", 1 + gen_rand(g, 400));
+        gen_line(g, "3 QUAY %d", gen_rand(g, 4));
+    }
+    if (gen_rand(g, 10) == 0) { // inline object
+        gen_line(g, "2 OBJE");
+        gen_line(g, "3 FILE C:\\Users\\me\\Photos\\img%04d.%s", gen_rand(g, 10000),
+            PICK(g, ((const char *const[]){"jpg", "gif", "tif", "bmp", "png"})));
+        gen_line(g, "3 FORM %s", PICK(g, ((const char *const[]){"jpg", "gif", "tif", "bmp", "png"})));
+        gen_line(g, "3 TITL Photo of the %s", PICK(g, gen_word));
+    }
+}
+
+static void gen_indi(Gen *g) {
+    char buf[64];
+    int n = ++(g->people);
+    int year = 1600 + gen_rand(g, 350);
+    const char *surn = PICK(g, gen_surname);
+    gen_line(g, "0 %s INDI", gen_xref('I', n, buf));
+    gen_line(g, "1 NAME %s /%s/", PICK(g, gen_given), surn);
+    if (gen_rand(g, 2)) {
+        gen_line(g, "2 SURN %s", surn);
+        if (gen_rand(g, 5) == 0) gen_line(g, "2 TYPE %s", PICK(g, ((const char *const[]){
+            "birth", "aka", "Married", "maiden", "nickname"})));
+    }
+    gen_line(g, "1 %s %s", PICK(g, ((const char *const[]){"SEX", "SEX", "SEX", "Sex", "sex"})),
+        PICK(g, ((const char *const[]){"M", "F", "M", "F", "U", "m", "f"})));
+    gen_event(g, gen_rand(g, 3) ? "BIRT" : "CHR", year);
+    if (gen_rand(g, 3)) gen_event(g, gen_rand(g, 4) ? "DEAT" : "BURI", year + 1 + gen_rand(g, 90));
+    if (gen_rand(g, 4) == 0) gen_event(g, "RESI", year + 20 + gen_rand(g, 30));
+    if (gen_rand(g, 6) == 0) gen_line(g, "1 %s %s", PICK(g, ((const char *const[]){"OCCU", "occu", "Occu"})), PICK(g, gen_word));
+    if (g->families) {
+        gen_line(g, "1 FAMC %s", gen_xref('F', 1 + gen_rand(g, g->families), buf));
+        if (gen_rand(g, 5) == 0) gen_line(g, "2 PEDI %s", PICK(g, ((const char *const[]){
+            "birth", "Adopted", "FOSTER", "step"})));
+    }
+    if (gen_rand(g, 2)) gen_line(g, "1 FAMS %s", gen_xref('F', g->families + 1 + gen_rand(g, 3), buf));
+    if (gen_rand(g, 8) == 0) {
+        gen_line(g, "1 ASSO %s", gen_xref('I', 1 + gen_rand(g, n), buf));
+        gen_line(g, "2 RELA %s", PICK(g, ((const char *const[]){"Godfather", "witness", "friend", "cousin"})));
+    }
+    if (gen_rand(g, 3) == 0) gen_text(g, 1, "NOTE", 100 + gen_rand(g, 1500));
+    else if (g->notes && gen_rand(g, 4) == 0) gen_line(g, "1 NOTE %s", gen_xref('N', 1 + gen_rand(g, g->notes), buf));
+    if (gen_rand(g, 10) == 0) gen_line(g, "1 LANG %s", PICK(g, gen_lang));
+    if (gen_rand(g, 5) == 0) gen_line(g, "1 RESN %s", PICK(g, ((const char *const[]){"privacy", "LOCKED", "secret"})));
+    if (gen_rand(g, 4) == 0) gen_line(g, "1 _UID %08X%08X", gen_rand(g, 1u<<30), gen_rand(g, 1u<<30));
+    if (gen_rand(g, 6) == 0) gen_line(g, "1 RFN %d", gen_rand(g, 100000));
+    if (gen_rand(g, 6) == 0) gen_line(g, "1 %s %s", PICK(g, ((const char *const[]){"_MILT", "_LOC", "_FSFTID", "_EMAIL"})), PICK(g, gen_word));
+    gen_line(g, "1 CHAN");
+    gen_line(g, "2 DATE %d %s %d", 1 + gen_rand(g, 28), PICK(g, gen_month), 1995 + gen_rand(g, 25));
+    gen_line(g, "3 TIME %02d:%02d:%02d", gen_rand(g, 24), gen_rand(g, 60), gen_rand(g, 60));
+}
+
+static void gen_fam(Gen *g) {
+    char buf[64];
+    int n = ++(g->families);
+    gen_line(g, "0 %s FAM", gen_xref('F', n, buf));
+    if (g->people) {
+        gen_line(g, "1 HUSB %s", gen_xref('I', 1 + gen_rand(g, g->people), buf));
+        gen_line(g, "1 WIFE %s", gen_xref('I', 1 + gen_rand(g, g->people), buf));
+        for(int i = gen_rand(g, 6); i > 0; i -= 1) {
+            gen_line(g, "1 CHIL %s", gen_xref('I', g->people + 1 + gen_rand(g, 20), buf));
+            if (gen_rand(g, 6) == 0) gen_line(g, "2 _FREL %s", PICK(g, ((const char *const[]){"Natural", "Adopted"})));
+        }
+    }
+    gen_event(g, "MARR", 1620 + gen_rand(g, 330));
+    if (gen_rand(g, 10) == 0) gen_event(g, "DIV", 1700 + gen_rand(g, 300));
+}
+
+static void gen_sour(Gen *g) {
+    char buf[64];
+    int n = ++(g->sources);
+    gen_line(g, "0 %s SOUR", gen_xref('S', n, buf));
+    gen_line(g, "1 TITL %s parish %s, %d-%d", PICK(g, gen_place), PICK(g, gen_word), 1600 + n%300, 1700 + n%300);
+    gen_line(g, "1 AUTH %s %s", PICK(g, gen_given), PICK(g, gen_surname));
+    gen_text(g, 1, "PUBL", 50 + gen_rand(g, 300));
+    if (gen_rand(g, 2)) gen_text(g, 1, "TEXT", 200 + gen_rand(g, 2000));
+    if (gen_rand(g, 3) == 0) {
+        gen_line(g, "1 OBJE");
+        gen_line(g, "2 FILE /home/me/scans/sour%d.tif", n);
+        gen_line(g, "2 FORM tif");
+    }
+}
+
+static void gen_note(Gen *g) {
+    char buf[64];
+    int n = ++(g->notes);
+    char tag[80];
+    sprintf(tag, "%s NOTE", gen_xref('N', n, buf));
+    gen_text(g, 0, tag, 200 + gen_rand(g, 3000));
+}
+
+int main(int argc, char *argv[]) {
+    Gen g = {0};
+    long size = 8000000;
+    unsigned long seed = 1;
+    for(int i=1; i<argc; i+=1) {
+        if (!strcmp("-s", argv[i]) && i+1 < argc) size = atol(argv[++i]);
+        else if (!strcmp("-r", argv[i]) && i+1 < argc) seed = strtoul(argv[++i], 0, 10);
+        else if (!strcmp("-e", argv[i]) && i+1 < argc) {
+            i += 1;
+            if (!strcmp("utf8", argv[i])) g.enc = GEN_UTF8;
+            else if (!strcmp("ansel", argv[i])) g.enc = GEN_ANSEL;
+            else if (!strcmp("utf16le", argv[i])) g.enc = GEN_UTF16LE;
+            else if (!strcmp("utf16be", argv[i])) g.enc = GEN_UTF16BE;
+            else {
+                fprintf(stderr, "ERROR: unknown encoding %s\n", argv[i]);
+                return 4;
+            }
+        } else {
+            fprintf(stderr, "USAGE: %s [-s bytes] [-e utf8|ansel|utf16le|utf16be] [-r seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    g.rng = 0x9E3779B97F4A7C15ull ^ seed;
+
+    if (g.enc == GEN_UTF16LE) fwrite("\xFF\xFE", 1, 2, stdout);
+    if (g.enc == GEN_UTF16BE) fwrite("\xFE\xFF", 1, 2, stdout);
+    gen_line(&g, "0 HEAD");
+    gen_line(&g, "1 SOUR GENGEDCOM");
+    gen_line(&g, "2 VERS 1.0");
+    gen_line(&g, "1 DEST ANY");
+    gen_line(&g, "1 DATE 17 OCT 2021");
+    gen_line(&g, "1 SUBM @U1@");
+    gen_line(&g, "1 FILE C:\\My Documents\\family.ged");
+    gen_line(&g, "1 GEDC");
+    gen_line(&g, "2 VERS 5.5.1");
+    gen_line(&g, "2 FORM LINEAGE-LINKED");
+    gen_line(&g, "1 CHAR %s", g.enc == GEN_ANSEL ? "ANSEL" : g.enc == GEN_UTF8 ? "UTF-8" : "UNICODE");
+    gen_line(&g, "1 LANG English");
+    gen_line(&g, "0 @U1@ SUBM");
+    gen_line(&g, "1 NAME %s %s", PICK(&g, gen_given), PICK(&g, gen_surname));
+
+    while (g.written < size) {
+        unsigned r = gen_rand(&g, 100);
+        if (r < 60) gen_indi(&g);
+        else if (r < 85) gen_fam(&g);
+        else if (r < 93) gen_sour(&g);
+        else gen_note(&g);
+    }
+    gen_line(&g, "0 TRLR");
+    return 0;
+}
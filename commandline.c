@@ -1,5 +1,8 @@
 #include "ged_ebp.h"
+#include "gedbatch.h"
+#include "gedindex.h"
 #include <string.h>
+#include <stdlib.h> // for atoi
 
 /**
  * Simple command-line wrapper.
@@ -10,29 +13,109 @@ int main(int argc, char *argv[]) {
     FILE *out = stdout;
     
     int overwrite = 0;
-    ged_xref_case_insensitive = 0;
-    ged_few_phrases = 0;
+    const char *inpath = 0;
+    char *records = 0; // comma-separated xrefs, if converting only some
+    int linked = 0;
+    GedOptions options = {0};
+    options.threads = 1;
+    GedBatch batch = {0};
 
     for(int i=1; i<argc; i+=1) {
         if (!strcmp("-h", argv[i])
         || !strcmp("--help", argv[i])) {
             fprintf(stderr, "USAGE: %s [options] [infile.ged] [outfile.ged]\n"
+            "   or: %s [options] --batch outdir (infile.ged | indir | -)...\n"
             "where options may be\n"
             "  -h --help        this help message\n"
             "  -f --force       overwrite existing outfile.ged\n"
             "  -x --xreficase   compare xrefs case-insensitively\n"
-            "  -p --fewphrases  omit PHRASE when reasonable payload available\n" , argv[0]);
+            "  -p --fewphrases  omit PHRASE when reasonable payload available\n"
+            "  -j --jobs N      convert records using N threads\n"
+            "  -s --stream      read the input only once (the default for pipes)\n"
+            "  -w --width N     put at most N bytes of a payload on one line, moving\n"
+            "                   the rest to CONC lines (which 7.0 does not have)\n"
+            "  -c --cache DIR   keep what the first pass learns about each input in\n"
+            "                   DIR, and skip that pass for inputs already there\n"
+            "  -P --profile FILE\n"
+            "                   write what each filter did, and how long it took,\n"
+            "                   to FILE (- for stderr) as JSON\n"
+            "  -r --records X,Y convert only HEAD and the records with these xrefs,\n"
+            "                   using (and making, if needed) infile.ged.idx\n"
+            "  -l --linked      with -r, also convert the records they point to\n"
+            "  -b --batch DIR   convert each following file, each .ged file in each\n"
+            "                   following directory, and each file named on stdin\n"
+            "                   if given -, into DIR; with -j N, N files at a time\n" , argv[0], argv[0]);
             return 1;
         }
         else if (!strcmp("-f", argv[i]) || !strcmp("--force", argv[i])) overwrite = 1;
-        else if (!strcmp("-x", argv[i]) || !strcmp("--xreficase", argv[i])) ged_xref_case_insensitive = 1;
-        else if (!strcmp("-p", argv[i]) || !strcmp("--fewphrases", argv[i])) ged_few_phrases = 1;
+        else if (!strcmp("-x", argv[i]) || !strcmp("--xreficase", argv[i])) options.xref_case_insensitive = 1;
+        else if (!strcmp("-p", argv[i]) || !strcmp("--fewphrases", argv[i])) options.few_phrases = 1;
+        else if (!strcmp("-s", argv[i]) || !strcmp("--stream", argv[i])) options.streaming = 1;
+        else if (!strcmp("-j", argv[i]) || !strcmp("--jobs", argv[i])) {
+            options.threads = (i+1 < argc) ? atoi(argv[i+1]) : 0;
+            if (options.threads < 1) {
+                fprintf(stderr, "ERROR: %s requires a positive number of threads\n", argv[i]);
+                return 4;
+            }
+            i += 1;
+        }
+        else if (!strcmp("-w", argv[i]) || !strcmp("--width", argv[i])) {
+            int width = (i+1 < argc) ? atoi(argv[i+1]) : 0;
+            if (width < 1) {
+                fprintf(stderr, "ERROR: %s requires a positive number of bytes\n", argv[i]);
+                return 4;
+            }
+            options.line_limit = (size_t)width;
+            i += 1;
+        }
+        else if (!strcmp("-c", argv[i]) || !strcmp("--cache", argv[i])) {
+            if (i+1 >= argc) {
+                fprintf(stderr, "ERROR: %s requires a directory\n", argv[i]);
+                return 4;
+            }
+            options.cache_dir = argv[i+1];
+            i += 1;
+        }
+        else if (!strcmp("-P", argv[i]) || !strcmp("--profile", argv[i])) {
+            if (i+1 >= argc) {
+                fprintf(stderr, "ERROR: %s requires a file name\n", argv[i]);
+                return 4;
+            }
+            options.profile = strcmp("-", argv[i+1]) ? fopen(argv[i+1], "w") : stderr;
+            if (!options.profile) {
+                fprintf(stderr, "ERROR: unable to write to %s\n", argv[i+1]);
+                return 3;
+            }
+            i += 1;
+        }
+        else if (!strcmp("-r", argv[i]) || !strcmp("--records", argv[i])) {
+            if (i+1 >= argc) {
+                fprintf(stderr, "ERROR: %s requires a list of xrefs\n", argv[i]);
+                return 4;
+            }
+            records = argv[i+1];
+            i += 1;
+        }
+        else if (!strcmp("-l", argv[i]) || !strcmp("--linked", argv[i])) linked = 1;
+        else if (!strcmp("-b", argv[i]) || !strcmp("--batch", argv[i])) {
+            if (i+1 >= argc) {
+                fprintf(stderr, "ERROR: %s requires an output directory\n", argv[i]);
+                return 4;
+            }
+            batch.outdir = argv[i+1];
+            i += 1;
+        }
+        else if (batch.outdir) {
+            if (!strcmp("-", argv[i])) gedBatch_addList(&batch, stdin);
+            else gedBatch_add(&batch, argv[i]);
+        }
         else if (in == stdin) {
             in = fopen(argv[i], "rb");
             if (!in) {
                 fprintf(stderr, "ERROR: unable to read from %s\n", argv[i]);
                 return 2;
             }
+            inpath = argv[i];
         }
         else if (out == stdout) {
             out = fopen(argv[i], overwrite ? "wb" : "wxb");
@@ -46,13 +129,57 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    if (batch.outdir) {
+        batch.overwrite = overwrite;
+        batch.jobs = options.threads;
+        batch.options = options;
+        size_t failed = gedBatch_run(&batch, stdout);
+        fprintf(stderr, "%zu of %zu files converted\n", batch.count - failed, batch.count);
+        gedBatch_free(&batch);
+        return failed ? 6 : 0;
+    }
+
     if (out == stdout && overwrite) {
         fprintf(stderr, "ERROR: --force flag incompatible with stdout output\n");
         return 5;
     }
 
-    ged551to700(in, out);
-    return 0;
+    int status = 0;
+    if (records && !inpath) {
+        fprintf(stderr, "ERROR: --records requires an input file\n");
+        status = 4;
+    } else if (records) {
+        const char **xrefs = malloc(sizeof(char *)*(strlen(records)/2 + 1));
+        size_t count = 0;
+        for(char *x = strtok(records, ","); x; x = strtok(0, ",")) xrefs[count++] = x;
+        char *sidecar = malloc(strlen(inpath) + 5);
+        strcpy(sidecar, inpath);
+        strcat(sidecar, ".idx");
+        GedIndex ix = {0};
+        // -1 if unable to index, else what gedIndex_convert returned
+        int found = gedIndex_open(&ix, in, sidecar) ? -1 
+            : gedIndex_convert(&ix, in, xrefs, count, linked, out, &options);
+        if (found == 3) { // the input changed since the index was saved
+            gedIndex_free(&ix);
+            remove(sidecar);
+            found = gedIndex_open(&ix, in, sidecar) ? -1 
+                : gedIndex_convert(&ix, in, xrefs, count, linked, out, &options);
+            if (found == 3) fprintf(stderr, "ERROR: the index does not match %s\n", inpath);
+        }
+        if (found < 0) fprintf(stderr, "ERROR: unable to index %s\n", inpath);
+        if (found == 2)
+            for(size_t i=0; i<count; i+=1)
+                if (!gedIndex_has(&ix, xrefs[i])) fprintf(stderr, "ERROR: no record %s in %s\n", xrefs[i], inpath);
+        gedIndex_free(&ix);
+        free(sidecar);
+        free(xrefs);
+        status = found < 0 ? 2 : found >= 2 ? 7 : found ? 8 : 0;
+    } else if (ged551to700(in, out, &options)) {
+        status = 8; // the output ends with a _PARSE_ERROR saying why
+    }
+
+    if (options.profile && options.profile != stderr) fclose(options.profile);
+    return status;
 }
 
 
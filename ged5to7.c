@@ -0,0 +1,47 @@
+/**
+ * The embeddable interface to the converter; see ged5to7.h.
+ * 
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+
+#include <stdlib.h> // for calloc, realloc, and free
+#include <string.h> // for memcpy
+#include "ged5to7.h"
+
+struct Ged5to7_t {
+    GedOptions options;
+    char *pushed; size_t len, cap; // input given to ged5to7_push
+};
+
+Ged5to7 *ged5to7_create(const GedOptions *options) {
+    Ged5to7 *ctx = calloc(1, sizeof(Ged5to7));
+    if (options) ctx->options = *options;
+    return ctx;
+}
+
+void ged5to7_free(Ged5to7 *ctx) {
+    free(ctx->pushed);
+    free(ctx);
+}
+
+int ged5to7_convert(Ged5to7 *ctx, const void *in, size_t len, GedWriteFunc out, void *arg) {
+    return ged551to700_memory(in, len, out, arg, &ctx->options);
+}
+
+void ged5to7_push(Ged5to7 *ctx, const void *in, size_t len) {
+    if (!len) return; // `in` may be NULL
+    if (ctx->len + len > ctx->cap) {
+        ctx->cap = ctx->cap ? ctx->cap : (1<<16);
+        while (ctx->len + len > ctx->cap) ctx->cap *= 2;
+        ctx->pushed = realloc(ctx->pushed, ctx->cap);
+    }
+    memcpy(ctx->pushed + ctx->len, in, len);
+    ctx->len += len;
+}
+
+int ged5to7_finish(Ged5to7 *ctx, GedWriteFunc out, void *arg) {
+    int status = ged551to700_memory(ctx->pushed, ctx->len, out, arg, &ctx->options);
+    ctx->len = 0;
+    return status;
+}
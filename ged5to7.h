@@ -0,0 +1,58 @@
+/**
+ * The embeddable interface to the converter (libged5to7).
+ * 
+ * A `Ged5to7` context holds the options of its conversions, so
+ * different contexts may use different options, and converts input
+ * that is already in memory, giving the output to a callback:
+ * 
+ * ```
+ * GedOptions opts = {0};
+ * opts.few_phrases = 1;
+ * Ged5to7 *ctx = ged5to7_create(&opts);
+ * ged5to7_convert(ctx, upload, upload_len, my_write, my_arg);
+ * ged5to7_free(ctx);
+ * ```
+ * 
+ * Input arriving in pieces can instead be given to `ged5to7_push` as
+ * it arrives and converted by `ged5to7_finish`. No output can come
+ * before all input has arrived (HEAD lists every extension tag in the
+ * file), so pushed input is held in memory until then.
+ * 
+ * The library has no mutable globals: any number of contexts may
+ * convert on any number of threads at once, and `ged5to7_convert` may
+ * be called on several threads at once with one context. The push
+ * functions of a context must only be called by one thread at a time.
+ * 
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+#pragma once
+
+#include <stddef.h> // size_t
+#include "ged_ebp.h" // GedOptions, GedWriteFunc
+
+typedef struct Ged5to7_t Ged5to7;
+
+/// makes a context with a copy of `options` (all zeros if NULL)
+Ged5to7 *ged5to7_create(const GedOptions *options);
+
+/// frees a context and any input pushed to it but not yet converted
+void ged5to7_free(Ged5to7 *ctx);
+
+/**
+ * Converts `len` bytes at `in`, giving the output to `out` (with `arg`)
+ * in order as it is made. Returns 0 on success or nonzero if the input
+ * could not be fully parsed; the output then ends with a
+ * `_PARSE_ERROR` record saying why.
+ */
+int ged5to7_convert(Ged5to7 *ctx, const void *in, size_t len, GedWriteFunc out, void *arg);
+
+/// appends `len` bytes at `in` to the input `ged5to7_finish` will convert
+void ged5to7_push(Ged5to7 *ctx, const void *in, size_t len);
+
+/**
+ * Converts all input pushed since the last `ged5to7_finish` as
+ * `ged5to7_convert` would, then empties it so the context can be used
+ * for another input.
+ */
+int ged5to7_finish(Ged5to7 *ctx, GedWriteFunc out, void *arg);
@@ -7,6 +7,20 @@
 
 #include <stdlib.h> // for calloc and free
 #include <stdio.h>  // for fprintf
+#include <string.h> // for memcpy and strdup
+#include <time.h>   // for timespec_get
+
+#ifdef _WIN32
+#include <process.h> // for _getpid
+#define getpid _getpid
+#else
+#include <unistd.h> // for getpid
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#include <threads.h>
+#define GED_HAVE_THREADS
+#endif
 
 #include "ged_ebp.h"
 #include "ged_ebp_parse.h"
@@ -15,32 +29,102 @@
 
 
 void ged_destroy_event(GedEvent *evt) {
-    if (evt->type == GED_RECORD && (evt->flags & GED_OWNS_DATA)) {
-        ged_destroy_structure(evt->record);
-    } else if (evt->data && (evt->flags & GED_OWNS_DATA)) {
+    if (evt->type != GED_RECORD && evt->data && (evt->flags & GED_OWNS_DATA)) {
         free(evt->data);
         evt->data = 0;
     }
     evt->flags = 0;
+    evt->tag = GED_TAG_NONE;
     evt->type = GED_UNUSED;
 }
 
 
 
-/// recursively frees all structures in a record
-void ged_destroy_structure(GedStructure *s) {
-    while (s) {
-        if (s->child) ged_destroy_structure(s->child);
-        ged_destroy_event(&s->tag);
-        ged_destroy_event(&s->anchor);
-        ged_destroy_event(&s->payload);
-        GedStructure *tmp = s;
-        s = s->sibling;
-        free(tmp);
+GedRecord *gedRecord_create(GedArena *arena) {
+    return gedArena_calloc(arena, sizeof(GedRecord));
+}
+
+int32_t gedRecord_add(GedRecord *r, GedArena *arena, int32_t parent, int32_t prev, int tag, const char *tagname) {
+    if (r->count >= r->cap) {
+        // the old array stays in the arena until the record is done
+        r->cap = r->cap ? r->cap*2 : 32;
+        GedNode *bigger = gedArena_alloc(arena, sizeof(GedNode)*r->cap);
+        if (r->count) memcpy(bigger, r->nodes, sizeof(GedNode)*r->count);
+        r->nodes = bigger;
+    }
+    int32_t i = r->count++;
+    GedNode *n = r->nodes + i;
+    n->tag = tag;
+    n->tagname = tagname ? tagname : gedTag_name(tag);
+    n->parent = parent;
+    n->child = -1;
+    n->payload = 0;
+    n->len = 0;
+    n->type = GED_UNUSED;
+    if (prev >= 0) {
+        n->next = r->nodes[prev].next;
+        r->nodes[prev].next = i;
+    } else if (parent >= 0) {
+        n->next = r->nodes[parent].child;
+        r->nodes[parent].child = i;
+    } else {
+        n->next = -1;
     }
+    return i;
 }
 
+void gedRecord_walk(GedRecord *r, int32_t i, GedNodeVisitor pre, GedNodeVisitor post, void *arg) {
+    int32_t top = i;
+    for(;;) {
+        if (!(pre && pre(r, i, arg)) && r->nodes[i].child >= 0) {
+            i = r->nodes[i].child;
+            continue;
+        }
+        // finish i and each enclosing structure it was the last one of
+        for(;;) {
+            if (post) post(r, i, arg);
+            if (i == top) return;
+            if (r->nodes[i].next >= 0) {
+                i = r->nodes[i].next;
+                break;
+            }
+            i = r->nodes[i].parent;
+        }
+    }
+}
 
+/// where `gedRecord_copy` is putting what it walks
+struct ged_record_copy {
+    GedRecord *to;
+    GedArena *arena;
+    int32_t parent, prev; // in `to`
+};
+
+static int ged_record_copy_pre(GedRecord *from, int32_t i, void *arg) {
+    struct ged_record_copy *c = (struct ged_record_copy *)arg;
+    const GedNode *n = from->nodes + i;
+    int32_t j = gedRecord_add(c->to, c->arena, c->parent, c->prev, n->tag, n->tagname);
+    c->to->nodes[j].payload = n->payload;
+    c->to->nodes[j].len = n->len;
+    c->to->nodes[j].type = n->type;
+    c->parent = j;
+    c->prev = -1;
+    return 0;
+}
+
+static int ged_record_copy_post(GedRecord *from, int32_t i, void *arg) {
+    struct ged_record_copy *c = (struct ged_record_copy *)arg;
+    c->prev = c->parent;
+    c->parent = c->to->nodes[c->parent].parent;
+    return 0;
+}
+
+int32_t gedRecord_copy(GedRecord *to, GedArena *arena, int32_t parent, int32_t prev, const GedRecord *from, int32_t i) {
+    struct ged_record_copy c = {to, arena, parent, prev};
+    // the walk changes nothing in `from`
+    gedRecord_walk((GedRecord *)from, i, ged_record_copy_pre, ged_record_copy_post, &c);
+    return c.prev;
+}
 
 
 
@@ -50,9 +134,18 @@ void ged_destroy_structure(GedStructure *s) {
  */
 
 
+/// what one pipeline entry did in one pass; see `GedOptions.profile`
+struct ged_profile {
+    size_t in, out; // events given to it and emitted by it
+    unsigned long long ns; // time spent in it
+    size_t bytes; // bytes it allocated in the arena
+};
+
+/// one filter of a compiled pipeline: a non-null pass function and its state
 struct ged_filter {
-    GedFilterFunc passes[2];
+    GedFilterFunc func;
     void *state;
+    struct ged_profile *profile; // where to count its work, or NULL
 };
 
 struct ged_event_stage {
@@ -60,10 +153,21 @@ struct ged_event_stage {
     size_t stage; // index of next filter to use from pipeline
 };
 
+/**
+ * The emitter filters are given. The first event a filter emits is
+ * held in `held` rather than pushed, so that the common case of one
+ * event in and one event out continues directly to the next filter;
+ * only when a second event is emitted do both go on the stack.
+ */
 struct ged_event_stage_stack {
     void (*emit)(struct ged_event_stage_stack *self, GedEvent event);
+    GedArena *arena; // these three must follow emit
+    const GedOptions *options; // to match GedEmitterTemplate
+    size_t run;
     struct ged_event_stage *stack;
-    size_t cap, top, last, stage;
+    size_t cap, top, stage;
+    GedEvent held; // the first event emitted by the current filter
+    size_t emitted; // number of events emitted by the current filter
 };
 
 
@@ -74,10 +178,8 @@ void _show_stack_entry(const struct ged_event_stage *entry) {
 }
 void _show_stack(const struct ged_event_stage_stack *stack) {
     fprintf(stderr, "-------- Stack -------\n");
-    for(size_t i=0; i<stack->top; i+=1) {
-        fprintf(stderr, "%c", (i==stack->last ? '>' : ' '));
+    for(size_t i=0; i<stack->top; i+=1)
         _show_stack_entry(stack->stack + i);
-    }
     fprintf(stderr, "----------------------\n");
 }
 
@@ -100,7 +202,7 @@ void _show_event(const GedEvent *event) {
 }
 
 
-void ged_event_stage_stack_emit(struct ged_event_stage_stack *self, GedEvent event) {
+void ged_event_stage_stack_push(struct ged_event_stage_stack *self, GedEvent event) {
     if (!self->cap) { 
         self->cap = 4; 
         self->stack = malloc(sizeof(struct ged_event_stage)*self->cap); 
@@ -109,29 +211,33 @@ void ged_event_stage_stack_emit(struct ged_event_stage_stack *self, GedEvent eve
         self->cap *= 2;
         self->stack = realloc(self->stack, sizeof(struct ged_event_stage)*self->cap);
     }
-    self->stack[self->top].event.type = event.type;
-    self->stack[self->top].event.data = event.data;
-    self->stack[self->top].event.flags = event.flags;
+    self->stack[self->top].event = event;
     self->stack[self->top].stage = self->stage;
     self->top += 1; 
 }
-struct ged_event_stage ged_event_stage_stack_pop(struct ged_event_stage_stack *self) {
-    if (self->last+1 < self->top) { // need to reorder
-        size_t swaps = (self->top-self->last)>>1;
-        for(size_t i=0; i<swaps; i+=1) {
-            struct ged_event_stage tmp = self->stack[self->last+i];
-            self->stack[self->last+i] = self->stack[self->top-i-1];
-            self->stack[self->top-i-1] = tmp;
-        }
+void ged_event_stage_stack_emit(struct ged_event_stage_stack *self, GedEvent event) {
+    if (self->emitted == 0) self->held = event;
+    else {
+        if (self->emitted == 1) ged_event_stage_stack_push(self, self->held);
+        ged_event_stage_stack_push(self, event);
+    }
+    self->emitted += 1;
+}
+/// reverses the `count` most recently pushed entries so the first of them is on top
+void ged_event_stage_stack_reverse(struct ged_event_stage_stack *self, size_t count) {
+    struct ged_event_stage *lo = self->stack + self->top - count;
+    struct ged_event_stage *hi = self->stack + self->top - 1;
+    while (lo < hi) {
+        struct ged_event_stage tmp = *lo;
+        *(lo++) = *hi;
+        *(hi--) = tmp;
     }
-    self->top -= 1;
-    self->last = self->top;
-    return self->stack[self->top];
 }
 
-struct ged_event_stage_stack *ged_event_stage_stack_create() {
+struct ged_event_stage_stack *ged_event_stage_stack_create(const GedOptions *options) {
     struct ged_event_stage_stack *ans = calloc(1, sizeof(struct ged_event_stage_stack));
     ans->emit = ged_event_stage_stack_emit;
+    ans->options = options;
     return ans;
 }
 void ged_event_stage_stack_free(struct ged_event_stage_stack *x) {
@@ -140,61 +246,677 @@ void ged_event_stage_stack_free(struct ged_event_stage_stack *x) {
 }
 
 
-void ged551to700(FILE *from, FILE *to) {
+/// makes the states of the pipeline entries with `ordered` at most `upto`
+static void ged_make_states(void **states, int upto) {
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    for(size_t i=0; i<n; i+=1)
+        states[i] = (ged_pipeline[i].ordered <= upto) ? ged_pipeline[i].maker() : 0;
+}
+/// frees the states made by `ged_make_states`
+static void ged_free_states(void **states, int upto) {
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    for(size_t i=0; i<n; i+=1)
+        if (ged_pipeline[i].ordered <= upto) ged_pipeline[i].freer(states[i]);
+}
+
+/**
+ * Writes to `f` what the first pass left in those `states` whose entry
+ * has a saver and `ordered` at most `upto`: for each, a line with its
+ * name followed by what its saver writes.
+ */
+static void ged_states_save(FILE *f, void **states, int upto) {
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    for(size_t i=0; i<n; i+=1) {
+        if (!ged_pipeline[i].save || ged_pipeline[i].ordered > upto) continue;
+        fprintf(f, "%s\n", ged_pipeline[i].name);
+        ged_pipeline[i].save(states[i], f);
+    }
+}
+/// loads what `ged_states_save` wrote into `states`; returns 1 if all of it did
+static int ged_states_load(FILE *f, void **states, int upto) {
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    char line[64];
+    int ok = 1;
+    for(size_t i=0; ok && i<n; i+=1) {
+        if (!ged_pipeline[i].save || ged_pipeline[i].ordered > upto) continue;
+        size_t len = strlen(ged_pipeline[i].name);
+        ok = fgets(line, sizeof(line), f) && !strncmp(line, ged_pipeline[i].name, len) 
+            && line[len] == '\n' && !ged_pipeline[i].load(states[i], f);
+    }
+    return ok;
+}
+
+/**
+ * Fills `filters` with the non-null functions of pass `pass` of each
+ * pipeline entry whose `ordered` is between `from` and `upto`, paired
+ * with its state from `states` and its counters from `profile` (which
+ * may be NULL), and returns how many there are.
+ */
+static size_t ged_compile_pass(struct ged_filter *filters, void **states, struct ged_profile *profile, int pass, int from, int upto) {
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    size_t count = 0;
+    for(size_t i=0; i<n; i+=1) {
+        if (!ged_pipeline[i].passes[pass]) continue;
+        if (ged_pipeline[i].ordered < from || ged_pipeline[i].ordered > upto) continue;
+        filters[count].func = ged_pipeline[i].passes[pass];
+        filters[count].state = states[i];
+        filters[count].profile = profile ? profile + i : 0;
+        count += 1;
+    }
+    return count;
+}
+
+/// a clock for profiling, in nanoseconds
+static unsigned long long ged_profile_now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/// writes the counters of both passes, `profile[0..2n)`, to `to` as JSON
+static void ged_profile_write(FILE *to, const struct ged_profile *profile) {
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    const char *sep = "";
+    fprintf(to, "[");
+    for(int pass=0; pass<2; pass+=1) for(size_t i=0; i<n; i+=1) {
+        if (!ged_pipeline[i].passes[pass]) continue;
+        const struct ged_profile *p = profile + pass*n + i;
+        fprintf(to, "%s\n  {\"stage\": \"%s\", \"pass\": %d, \"events_in\": %zu, \"events_out\": %zu, \"nanoseconds\": %llu, \"arena_bytes\": %zu}",
+            sep, ged_pipeline[i].name, pass+1, p->in, p->out, p->ns, p->bytes);
+        sep = ",";
+    }
+    fprintf(to, "\n]\n");
+    fflush(to);
+}
+
+/**
+ * Runs `e` through the `count` filters of `pipeline` and gives each
+ * event that comes out of the last one to `out`.
+ */
+static void ged_run_pipeline(struct ged_event_stage_stack *stack, struct ged_filter *pipeline, size_t count, GedEvent e, void (*out)(GedEvent, void *), void *arg) {
+    struct ged_event_stage pair = {e, 0};
+    for(;;) {
+        //_show_stack(stack);
+        if (pair.stage >= count) {
+            out(pair.event, arg);
+        } else {
+            stack->stage = pair.stage + 1;
+            stack->emitted = 0;
+            struct ged_profile *p = pipeline[pair.stage].profile;
+            unsigned long long t0 = 0;
+            size_t b0 = 0;
+            if (p) {
+                t0 = ged_profile_now();
+                b0 = stack->arena ? stack->arena->allocated : 0;
+            }
+            pipeline[pair.stage].func(
+                &(pair.event),
+                (GedEmitterTemplate *)stack, 
+                pipeline[pair.stage].state
+            );
+            if (p) {
+                p->ns += ged_profile_now() - t0;
+                p->bytes += (stack->arena ? stack->arena->allocated : 0) - b0;
+                p->in += 1;
+                p->out += stack->emitted;
+            }
+            if (stack->emitted == 1) { // continue without the stack
+                pair.event = stack->held;
+                pair.stage += 1;
+                continue;
+            }
+            if (stack->emitted > 1)
+                ged_event_stage_stack_reverse(stack, stack->emitted);
+        }
+        if (!stack->top) break;
+        stack->top -= 1;
+        pair = stack->stack[stack->top];
+    }
+}
+
+static void ged_discard_out(GedEvent e, void *unused) {
+    ged_destroy_event(&e);
+}
+static void ged_sink_out(GedEvent e, void *dst) {
+    gedEventSinkFunc(e, (GedEventSinkState *)dst);
+}
+
+
+
+#ifdef GED_HAVE_THREADS
+
+/**
+ * Multithreaded pass 2. One thread cuts the decoded input into chunks
+ * of whole records; worker threads each run the unordered filters on
+ * a chunk at a time with their own filter states; and the calling
+ * thread runs the ordered filters and the sink on the results, one
+ * chunk at a time in file order.
+ */
+
+#define GED_CHUNK_SIZE (1<<18)
+
+struct ged_chunk {
+    char *text; size_t len;
+    int end; // what the reader gave after `text`: EOF or an error
+    GedEventSourceState *src; // holds the strings of `events`
+    GedEvent *events; size_t count, cap;
+    GedEvent error; // GED_ERROR from `src`, if any
+    int ready; // the worker is done with it
+    size_t index; // of the chunk in the input, from 0
+};
+
+struct ged_parallel {
+    mtx_t lock;
+    cnd_t changed; // any of the fields below changed
+    struct ged_chunk **ring; size_t cap;
+    size_t read, claimed, written; // chunks through each step so far
+    int finished; // the reader will add no more chunks
+    int stop; // the writer wants no more chunks
+    DecodingFileReader *reader;
+    const GedOptions *options;
+};
+
+struct ged_worker {
+    struct ged_parallel *par;
+    void **states;
+    struct ged_profile *profile; // its own counters, or NULL
+    struct ged_filter *filters;
+    size_t count;
+    thrd_t thread;
+};
+
+static void ged_chunk_free(struct ged_chunk *c) {
+    for(size_t i=0; i<c->count; i+=1) ged_destroy_event(c->events + i);
+    free(c->events);
+    if (c->src) gedEventSource_free(c->src);
+    free(c->text);
+    free(c);
+}
+
+static void ged_chunk_out(GedEvent e, void *chunk) {
+    struct ged_chunk *c = (struct ged_chunk *)chunk;
+    if (c->count >= c->cap) {
+        c->cap = c->cap ? c->cap*2 : 1024;
+        c->events = realloc(c->events, sizeof(GedEvent)*c->cap);
+    }
+    c->events[c->count++] = e;
+}
+
+/**
+ * Reads whole records from `r` until at least GED_CHUNK_SIZE bytes or
+ * the end of the input. `*carry` holds bytes read past the previous
+ * chunk's last record; it is moved into the new chunk and replaced by
+ * those past this one's.
+ */
+static struct ged_chunk *ged_chunk_read(DecodingFileReader *r, struct ged_chunk **carry) {
+    struct ged_chunk *c = *carry;
+    *carry = 0;
+    size_t cap = c->len + GED_CHUNK_SIZE, scan = GED_CHUNK_SIZE;
+    c->text = realloc(c->text, cap);
+    for(;;) {
+        // look for a level-0 line past the first GED_CHUNK_SIZE bytes
+        for(; scan+1 < c->len; scan += 1) {
+            if (c->text[scan] != '0') continue;
+            if (c->text[scan-1] != '\n' && c->text[scan-1] != '\r') continue;
+            if (c->text[scan+1] != ' ' && c->text[scan+1] != '\t') continue;
+            *carry = calloc(1, sizeof(struct ged_chunk));
+            (*carry)->len = c->len - scan;
+            (*carry)->text = malloc((*carry)->len);
+            memcpy((*carry)->text, c->text + scan, (*carry)->len);
+            c->len = scan;
+            c->end = EOF;
+            return c;
+        }
+        const char *span;
+        long n = nextUTF8span(r, &span);
+        if (n < 0) { c->end = n; return c; }
+        if (c->len + n > cap) {
+            while (c->len + n > cap) cap *= 2;
+            c->text = realloc(c->text, cap);
+        }
+        memcpy(c->text + c->len, span, n);
+        c->len += n;
+        decodingFileReader_skip(r, n);
+    }
+}
+
+static int ged_reader_thread(void *arg) {
+    struct ged_parallel *par = (struct ged_parallel *)arg;
+    struct ged_chunk *carry = calloc(1, sizeof(struct ged_chunk));
+    while (carry) {
+        struct ged_chunk *c = ged_chunk_read(par->reader, &carry);
+        mtx_lock(&par->lock);
+        while (par->read - par->written >= par->cap && !par->stop)
+            cnd_wait(&par->changed, &par->lock);
+        if (par->stop) {
+            mtx_unlock(&par->lock);
+            ged_chunk_free(c);
+            break;
+        }
+        c->index = par->read;
+        par->ring[par->read % par->cap] = c;
+        par->read += 1;
+        cnd_broadcast(&par->changed);
+        mtx_unlock(&par->lock);
+    }
+    if (carry) ged_chunk_free(carry);
+    mtx_lock(&par->lock);
+    par->finished = 1;
+    cnd_broadcast(&par->changed);
+    mtx_unlock(&par->lock);
+    return 0;
+}
+
+/// parses `c` and runs the worker's filters on it
+static void ged_chunk_convert(struct ged_worker *w, struct ged_event_stage_stack *stack, struct ged_chunk *c) {
+    c->src = gedEventSource_createUTF8(c->text, c->len, c->end);
+    stack->arena = c->src->arena;
+    stack->run = c->index;
+    for(;;) {
+        GedEvent e = gedEventSource_get(c->src);
+        if (e.type == GED_EOF) break; // sent by the writer once at the end
+        if (e.type == GED_ERROR) {
+            c->error = e;
+            // a record was cut short; start afresh for the next chunk
+            // (which is never written, so needs nothing from pass 1)
+            ged_free_states(w->states, 0);
+            ged_make_states(w->states, 0);
+            w->count = ged_compile_pass(w->filters, w->states, w->profile, 1, 0, 0);
+            break;
+        }
+        ged_run_pipeline(stack, w->filters, w->count, e, ged_chunk_out, c);
+    }
+}
+
+static int ged_worker_thread(void *arg) {
+    struct ged_worker *w = (struct ged_worker *)arg;
+    struct ged_parallel *par = w->par;
+    struct ged_event_stage_stack *stack = ged_event_stage_stack_create(par->options);
+    mtx_lock(&par->lock);
+    for(;;) {
+        while (par->claimed == par->read && !par->finished)
+            cnd_wait(&par->changed, &par->lock);
+        if (par->claimed == par->read) break;
+        struct ged_chunk *c = par->ring[par->claimed % par->cap];
+        int stop = par->stop;
+        par->claimed += 1;
+        mtx_unlock(&par->lock);
+        
+        if (!stop) ged_chunk_convert(w, stack, c);
+        
+        mtx_lock(&par->lock);
+        c->ready = 1;
+        cnd_broadcast(&par->changed);
+    }
+    mtx_unlock(&par->lock);
+    ged_event_stage_stack_free(stack);
+    return 0;
+}
+
+/**
+ * Runs pass 2 of the conversion of `src`, already rewound, on
+ * `options->threads` worker threads, using `states` for the ordered
+ * filters and a copy of what pass 1 left in them for each worker's
+ * unordered ones, and adding to the pass-2 counters `profile` if not
+ * NULL. Returns 1 if it ended with a parse error, 0 if not, or -1 if it
+ * could not start (in which case nothing was read).
+ */
+static int ged_parallel_pass(GedEventSourceState *src, GedEventSinkState *dst, void **states, struct ged_profile *profile, const GedOptions *options) {
+    int threads = options->threads;
     size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
-    struct ged_filter *pipeline = malloc(sizeof(struct ged_filter)*n);
+    FILE *seed = tmpfile();
+    if (!seed) return -1;
+    ged_states_save(seed, states, 0);
+    struct ged_parallel par = {0};
+    mtx_init(&par.lock, mtx_plain);
+    cnd_init(&par.changed);
+    par.cap = 4*threads;
+    par.ring = malloc(sizeof(struct ged_chunk *)*par.cap);
+    par.reader = src->reader;
+    par.options = options;
     
-    for(int i=0; i<n; i+=1) {
-        pipeline[i].passes[0] = ged_pipeline[i].passes[0];
-        pipeline[i].passes[1] = ged_pipeline[i].passes[1];
-        pipeline[i].state = ged_pipeline[i].maker();
+    struct ged_worker *workers = calloc(threads, sizeof(struct ged_worker));
+    for(int i=0; i<threads; i+=1) {
+        workers[i].par = &par;
+        workers[i].states = malloc(sizeof(void *)*n);
+        workers[i].filters = malloc(sizeof(struct ged_filter)*n);
+        if (profile) workers[i].profile = calloc(n, sizeof(struct ged_profile));
+        ged_make_states(workers[i].states, 0);
+        rewind(seed);
+        ged_states_load(seed, workers[i].states, 0);
+        workers[i].count = ged_compile_pass(workers[i].filters, workers[i].states, workers[i].profile, 1, 0, 0);
     }
+    fclose(seed);
+    thrd_t reader;
+    thrd_create(&reader, ged_reader_thread, &par);
+    for(int i=0; i<threads; i+=1)
+        thrd_create(&workers[i].thread, ged_worker_thread, workers + i);
     
-    GedEventSourceState *src = gedEventSource_create(from);
-    GedEventSinkState *dst = gedEventSink_create(to);
-    struct ged_event_stage_stack *stack = ged_event_stage_stack_create();
+    struct ged_filter *ordered = malloc(sizeof(struct ged_filter)*n);
+    size_t count = ged_compile_pass(ordered, states, profile, 1, 1, 1);
+    struct ged_event_stage_stack *stack = ged_event_stage_stack_create(options);
+    int failed = 0;
+    mtx_lock(&par.lock);
+    for(;;) {
+        while (!(par.written < par.read && par.ring[par.written % par.cap]->ready)
+        && !(par.finished && par.written == par.read))
+            cnd_wait(&par.changed, &par.lock);
+        if (par.written == par.read) break;
+        struct ged_chunk *c = par.ring[par.written % par.cap];
+        mtx_unlock(&par.lock);
+        
+        if (!failed) {
+            stack->arena = c->src->arena;
+            for(size_t i=0; i<c->count; i+=1)
+                ged_run_pipeline(stack, ordered, count, c->events[i], ged_sink_out, dst);
+            c->count = 0;
+            if (c->error.type == GED_ERROR) {
+                gedEventSinkFunc(c->error, dst); // to show error
+                failed = 1;
+            }
+        }
+        ged_chunk_free(c);
+        
+        mtx_lock(&par.lock);
+        par.written += 1;
+        if (failed) par.stop = 1;
+        cnd_broadcast(&par.changed);
+    }
+    mtx_unlock(&par.lock);
+    if (!failed) {
+        GedEvent eof = {0};
+        eof.type = GED_EOF;
+        stack->arena = src->arena;
+        ged_run_pipeline(stack, ordered, count, eof, ged_sink_out, dst);
+    }
+    
+    thrd_join(reader, 0);
+    for(int i=0; i<threads; i+=1) {
+        thrd_join(workers[i].thread, 0);
+        ged_free_states(workers[i].states, 0);
+        free(workers[i].states);
+        if (workers[i].profile) {
+            for(size_t j=0; j<n; j+=1) {
+                profile[j].in += workers[i].profile[j].in;
+                profile[j].out += workers[i].profile[j].out;
+                profile[j].ns += workers[i].profile[j].ns;
+                profile[j].bytes += workers[i].profile[j].bytes;
+            }
+            free(workers[i].profile);
+        }
+        free(workers[i].filters);
+    }
+    free(workers);
+    ged_event_stage_stack_free(stack);
+    free(ordered);
+    free(par.ring);
+    cnd_destroy(&par.changed);
+    mtx_destroy(&par.lock);
+    return failed;
+}
+
+#endif // GED_HAVE_THREADS
+
+
+
+/// drops the output of the first record and sinks the rest
+struct ged_spill {
+    GedEventSinkState *sink;
+    int depth, started;
+};
+static void ged_spill_out(GedEvent e, void *arg) {
+    struct ged_spill *s = (struct ged_spill *)arg;
+    if (s->started) {
+        gedEventSinkFunc(e, s->sink);
+        return;
+    }
+    if (e.type == GED_START) s->depth += 1;
+    if (e.type == GED_END && --(s->depth) == 0) s->started = 1;
+    ged_destroy_event(&e);
+}
 
+/**
+ * Converts `src` reading it only once (see `GedOptions`), using
+ * `states` and `stack` and counting in `profile` (both passes' counters,
+ * or NULL), and returns the event that ended the input.
+ * 
+ * Two-pass entries of the pipeline run their first pass in place of
+ * their second, so the output of the first record (HEAD) is wrong;
+ * the rest is spilled to a temporary file. Once all input is read,
+ * a copy of the first record is converted again with the two-pass
+ * entries' second pass and fresh states for all other entries, which
+ * is how every filter first saw it, then the spill is copied after it.
+ */
+static GedEvent ged_single_pass(GedEventSourceState *src, GedEventSinkState *dst, struct ged_event_stage_stack *stack, void **states, struct ged_profile *profile) {
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    FILE *tmp = tmpfile();
+    if (!tmp) 
+        return (GedEvent){GED_ERROR, 0, .data="Unable to create a temporary file"};
+    
+    struct ged_filter *filters = malloc(sizeof(struct ged_filter)*n);
+    size_t count = 0;
+    for(size_t i=0; i<n; i+=1) {
+        int pass = ged_pipeline[i].passes[0] ? 0 : 1;
+        if (!ged_pipeline[i].passes[pass]) continue;
+        filters[count].func = ged_pipeline[i].passes[pass];
+        filters[count].state = states[i];
+        filters[count].profile = profile ? profile + pass*n + i : 0;
+        count += 1;
+    }
+    
+    struct ged_spill spill = {gedEventSink_create(tmp), 0, 0};
+    spill.sink->last.type = GED_END; // follows HEAD, so no byte order mark
+    spill.sink->line_limit = dst->line_limit;
+    GedEvent *head = 0;
+    size_t heads = 0, headcap = 0;
+    int depth = 0;
     GedEvent e;
+    for(;;) {
+        e = gedEventSource_get(src);
+        if (e.type == GED_ERROR) break;
+        if (depth >= 0 && e.type != GED_EOF) { // keep a copy of the first record
+            if (heads >= headcap) {
+                headcap = headcap ? headcap*2 : 64;
+                head = realloc(head, sizeof(GedEvent)*headcap);
+            }
+            head[heads] = e;
+            if (e.data) {
+                head[heads].data = strdup(e.data);
+                head[heads].flags |= GED_OWNS_DATA;
+            }
+            heads += 1;
+            if (e.type == GED_START) depth += 1;
+            if (e.type == GED_END && --depth == 0) depth = -1;
+        }
+        ged_run_pipeline(stack, filters, count, e, ged_spill_out, &spill);
+        if (e.type == GED_EOF) break;
+    }
+    
+    // redo the first record the way the two-pass conversion does it
+    void **fresh = malloc(sizeof(void *)*n);
+    for(size_t i=0; i<n; i+=1)
+        fresh[i] = ged_pipeline[i].passes[0] && ged_pipeline[i].passes[1]
+            ? states[i] : ged_pipeline[i].maker();
+    count = ged_compile_pass(filters, fresh, profile ? profile + n : 0, 1, 0, 1);
+    for(size_t i=0; i<heads; i+=1)
+        ged_run_pipeline(stack, filters, count, head[i], ged_sink_out, dst);
+    for(size_t i=0; i<n; i+=1)
+        if (fresh[i] != states[i]) ged_pipeline[i].freer(fresh[i]);
+    
+    // then the rest, continuing where the spill's sink left off
+    char buf[1<<14];
+    size_t got;
+    gedEventSink_flush(dst);
+    gedEventSink_flush(spill.sink);
+    rewind(tmp);
+    while ((got = fread(buf, 1, sizeof(buf), tmp)) > 0)
+        dst->write(buf, got, dst->arg);
+    if (spill.started) {
+        dst->last = spill.sink->last;
+        dst->level = spill.sink->level;
+    }
+    
+    gedEventSink_free(spill.sink);
+    fclose(tmp);
+    free(fresh);
+    free(head);
+    free(filters);
+    return e;
+}
+
+
+/// the first line of every cache file; change it when the format changes
+#define GED_CACHE_MAGIC "ged5to7 pass 1 cache 2\n"
+
+/**
+ * The path of the file in `dir` that caches the first pass over `src`,
+ * named by its SHA-256 and size, or NULL if `src` cannot be hashed. The
+ * caller frees it.
+ */
+static char *ged_cache_path(GedEventSourceState *src, const char *dir) {
+    unsigned char digest[32];
+    unsigned long long len;
+    if (decodingFileReader_hash(src->reader, digest, &len)) return 0;
+    char *path = malloc(strlen(dir) + 96);
+    size_t n = sprintf(path, "%s/", dir);
+    for(int i=0; i<32; i+=1) n += sprintf(path + n, "%02x", digest[i]);
+    sprintf(path + n, "-%llu.pass1", len);
+    return path;
+}
+
+/**
+ * Loads the cache file at `path` into `states` as if the first pass had
+ * run. Returns 1 if it did, or 0 if there is no such file or it is not
+ * one `ged_cache_save` wrote (in which case `states` are made afresh).
+ */
+static int ged_cache_load(const char *path, void **states) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    char line[64];
+    int ok = fgets(line, sizeof(line), f) && !strcmp(line, GED_CACHE_MAGIC)
+        && ged_states_load(f, states, 1);
+    fclose(f);
+    if (!ok) {
+        ged_free_states(states, 1);
+        ged_make_states(states, 1);
+    }
+    return ok;
+}
+
+/// saves what the first pass left in `states` to the cache file at `path`
+static void ged_cache_save(const char *path, void **states) {
+    // write elsewhere and rename, so no one loads a partly written file;
+    // the process and `states` make the name unique to this conversion
+    char *tmp = malloc(strlen(path) + 64);
+    sprintf(tmp, "%s.%ld-%p.tmp", path, (long)getpid(), (void *)states);
+    FILE *f = fopen(tmp, "wxb");
+    if (f) {
+        fputs(GED_CACHE_MAGIC, f);
+        ged_states_save(f, states, 1);
+        if (fclose(f) || rename(tmp, path)) remove(tmp);
+    }
+    free(tmp);
+}
+
+/**
+ * Converts all of `src` into `dst`. Returns 0, or 1 if the input could
+ * not be read or ended with a parse error (which is also given to `dst`).
+ */
+static int ged_convert(GedEventSourceState *src, GedEventSinkState *dst, const GedOptions *options) {
+    GedOptions defaults = {0};
+    if (!options) options = &defaults;
+    dst->line_limit = options->line_limit;
+    if (src->status) {
+        gedEventSinkFunc((GedEvent){GED_ERROR, 0, .data=(char *)decodingFileReader_error(src->status)}, dst);
+        gedEventSink_flush(dst);
+        return 1;
+    }
+    size_t n = (sizeof(ged_pipeline)/sizeof(ged_pipeline[0]));
+    void **states = malloc(sizeof(void *)*n);
+    ged_make_states(states, 1);
+    struct ged_profile *profile = 0; // n entries for each pass
+    if (options->profile) profile = calloc(2*n, sizeof(struct ged_profile));
+    
+    // a cached first pass, if there is one, stands in for running it
+    char *cache = 0;
+    int first = 0;
+    if (options->cache_dir && !options->streaming && gedEventSource_canRewind(src)) {
+        cache = ged_cache_path(src, options->cache_dir);
+        if (cache && ged_cache_load(cache, states)) first = 1;
+    }
+    
+    // compile each pass into a list of only the filters it uses
+    struct ged_filter *passes[2];
+    size_t active[2];
     for(int pass=0; pass<2; pass+=1) {
+        passes[pass] = malloc(sizeof(struct ged_filter)*n);
+        active[pass] = ged_compile_pass(passes[pass], states, profile ? profile + pass*n : 0, pass, 0, 1);
+    }
+    
+    struct ged_event_stage_stack *stack = ged_event_stage_stack_create(options);
+    stack->arena = src->arena;
+
+    GedEvent e;
+    if (options->streaming || !gedEventSource_canRewind(src))
+        e = ged_single_pass(src, dst, stack, states, profile);
+    else for(int pass=first; pass<2; pass+=1) {
         if (pass > 0) gedEventSource_rewind(src);
+#ifdef GED_HAVE_THREADS
+        if (pass > 0 && options->threads > 1) {
+            // errors were already shown
+            int failed = ged_parallel_pass(src, dst, states, profile ? profile + n : 0, options);
+            if (failed >= 0) {
+                e.type = failed ? GED_ERROR : GED_EOF;
+                e.data = 0;
+                break;
+            }
+        }
+#endif
         for(;;) { // infinite loop so that GED_EOF does get propogated
             e = gedEventSource_get(src);
             if (e.type == GED_ERROR) break;
-            stack->stage = 0;
-            stack->emit(stack, e);
-            while(stack->top) {
-                //_show_stack(stack);
-                struct ged_event_stage pair = ged_event_stage_stack_pop(stack);
-                while (pair.stage < n && !pipeline[pair.stage].passes[pass]) pair.stage += 1;
-                if (pair.stage >= n) {
-                    if (pass == 1) gedEventSinkFunc(pair.event, dst);
-                    else ged_destroy_event(&pair.event);
-                } else {
-                    stack->stage = pair.stage + 1;
-                    GedFilterFunc func = pipeline[pair.stage].passes[pass];
-                    func(
-                        &(pair.event),
-                        (GedEmitterTemplate *)stack, 
-                        pipeline[pair.stage].state
-                    );
-                }
-            }
+            ged_run_pipeline(stack, passes[pass], active[pass], e, 
+                pass ? ged_sink_out : ged_discard_out, pass ? (void *)dst : 0);
             if (e.type == GED_EOF) break;
         }
+        if (pass == 0 && cache && e.type == GED_EOF) ged_cache_save(cache, states);
     }
-    if (e.type == GED_ERROR)
+    if (e.type == GED_ERROR && e.data)
         gedEventSinkFunc(e, dst); // to show error if there is one
+    gedEventSink_flush(dst);
+
 
+    // free filter states first: they may hold structures in src's arena
+    ged_free_states(states, 1);
 
+    if (profile) {
+        ged_profile_write(options->profile, profile);
+        free(profile);
+    }
+    free(cache);
     ged_event_stage_stack_free(stack);
+    free(passes[0]);
+    free(passes[1]);
+    free(states);
+    return e.type == GED_ERROR;
+}
+
+int ged551to700(FILE *from, FILE *to, const GedOptions *options) {
+    GedEventSourceState *src = gedEventSource_create(from);
+    GedEventSinkState *dst = gedEventSink_create(to);
+    int status = ged_convert(src, dst, options);
     gedEventSink_free(dst);
     gedEventSource_free(src);
+    return status;
+}
 
-    for(int i=0; i<n; i+=1)
-        ged_pipeline[i].freer(pipeline[i].state);
-    
-    
-    free(pipeline);
+int ged551to700_memory(const void *in, size_t len, GedWriteFunc out, void *arg, const GedOptions *options) {
+    GedEventSourceState *src = gedEventSource_createMemory(in, len);
+    GedEventSinkState *dst = gedEventSink_createCallback(out, arg);
+    int status = ged_convert(src, dst, options);
+    gedEventSink_free(dst);
+    gedEventSource_free(src);
+    return status;
 }
 
 
@@ -229,6 +951,7 @@ void changePayloadToConst(GedEvent *e, const char *val) {
         e->flags &= ~GED_OWNS_DATA;
     }
     e->data = (char *)val;
+    e->tag = GED_TAG_NONE;
 }
 
 /** a helper for changing data */
@@ -236,11 +959,11 @@ void changePayloadToDynamic(GedEvent *e, char *val) {
     if (GED_OWNS_DATA & (e->flags)) free(e->data);
     e->flags |= GED_OWNS_DATA;
     e->data = val;
+    e->tag = GED_TAG_NONE;
 }
 
-
-
-/** Global flag; if nonzero, omit PHRASE when creating ENUMs */
-int ged_few_phrases;
-/** Global flag; if nonzero, compare xrefs case-insensitively */
-int ged_xref_case_insensitive;
+/** a helper for changing tags */
+void changeTagTo(GedEvent *e, int tag) {
+    changePayloadToConst(e, gedTag_name(tag));
+    e->tag = tag;
+}
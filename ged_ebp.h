@@ -21,6 +21,11 @@
  */
 #pragma once
 
+#include <stdio.h> // FILE
+#include <stdint.h> // int32_t
+#include "gedarena.h"
+#include "gedtag.h"
+
 typedef enum {
     GED_UNUSED = 0,
     
@@ -63,8 +68,8 @@ typedef enum {
      */
     GED_EOF,
     /**
-     * `GED_RECORD` indicates a full parsed record stored as a linked
-     * tree-like structure.
+     * `GED_RECORD` indicates a full parsed record, stored as a
+     * `GedRecord` in `record`.
      */
     GED_RECORD,
     /**
@@ -77,6 +82,14 @@ typedef enum {
     /**
      * GED_OWNS_DATA means the data has been allocated by this
      * GedEvent and should be freed when this GedEvent is freed.
+     * 
+     * Data without this flag is either constant or borrowed from the
+     * parser's per-record buffer; either way it is only guaranteed to
+     * be valid until the end of the current record, so filters that
+     * keep it longer than that must copy it.
+     * 
+     * `GED_RECORD` events never have this flag: a `GedRecord` and all
+     * it holds live in the arena of the record being processed.
      */
     GED_OWNS_DATA = 1,
     /**
@@ -87,37 +100,92 @@ typedef enum {
     GED_FIRST_USER_DEFINED_FLAG = 4,
 } GedFlags;
 
-typedef struct GedStructure_t GedStructure;
+typedef struct GedRecord_t GedRecord;
 
 typedef struct {
     GedEventType type;
     int flags;
+    int tag; // for GED_START, a GedTag or GED_TAG_NONE; see `ged_tag`
     union {
         char *data;
-        GedStructure *record;
+        GedRecord *record;
     };
 } GedEvent;
 
 /**
- * The structure is currently organized using GedEvents  with the
- * potential of an anchor at every level to simplify code and avoid
- * having to worry about what's `malloc`ed and what's not. This is 
- * definitely inefficient as only records may have IDs and we're keeping
- * at least two type fields and probably 3 flags we don't need.
+ * One structure of a `GedRecord`. Links are indices into the record's
+ * `nodes`, or -1 if there is no such structure.
+ */
+typedef struct {
+    int32_t tag;     // a GedTag, or an ID interned by the parser
+    int32_t parent;  // -1 for the record itself
+    int32_t child;   // first substructure
+    int32_t next;    // next substructure of `parent`
+    const char *tagname;
+    char *payload;   // NULL if there is none
+    uint32_t len;    // strlen(payload)
+    uint32_t type;   // GED_TEXT or GED_POINTER if there is a payload
+} GedNode;
+
+/**
+ * A whole record as one array of structures, the record itself first
+ * and the rest in the order they were parsed. Filters that add
+ * structures append them with `gedRecord_add`, so walk the links, not
+ * the array. Every string a record holds lives in the arena it was
+ * made in (see `GedEmitterTemplate`), so records are never freed.
  */
-struct GedStructure_t {
-    GedEvent tag; // a GED_START event
-    GedEvent anchor; // a GED_ANCHOR event
-    GedEvent payload; // either GED_TEXT or GED_POINTER
-    struct GedStructure_t *child;   // first child
-    struct GedStructure_t *sibling; // next sibling
+struct GedRecord_t {
+    GedNode *nodes; int32_t count, cap;
+    char *anchor; // the record's cross-reference identifier, or NULL
 };
 
+/**
+ * The interned ID of the tag of a GED_START event. The parser fills it
+ * in; for events made or renamed by filters it is looked up on first
+ * use, so filters that change `data` of a GED_START must either use
+ * `changePayloadToConst`/`changePayloadToDynamic` or zero `tag`.
+ */
+static inline int ged_tag(GedEvent *e) {
+    if (!e->tag) e->tag = gedTag_lookup(e->data);
+    return e->tag;
+}
+
 /// frees `data` and sets type and sets all `GedEvent` bytes to 0
 void ged_destroy_event(GedEvent *evt);
 
-/// recursively frees all structures in a record
-void ged_destroy_structure(GedStructure *r);
+/// a record with no structures yet, in `arena`
+GedRecord *gedRecord_create(GedArena *arena);
+
+/**
+ * Adds a structure with the given tag to `r` as a substructure of
+ * `parent`, right after its substructure `prev` (or first if `prev` is
+ * -1), and returns its index. Pass -1 for both to add the record
+ * itself. `tagname` must last as long as `arena`; if NULL, it is the
+ * name of the known tag `tag`. This may move `r->nodes`.
+ */
+int32_t gedRecord_add(GedRecord *r, GedArena *arena, int32_t parent, int32_t prev, int tag, const char *tagname);
+
+/**
+ * A callback for `gedRecord_walk`, given the index of a structure of
+ * `r`. It may change that structure's substructures and add new ones.
+ */
+typedef int (*GedNodeVisitor)(GedRecord *r, int32_t i, void *arg);
+
+/**
+ * Visits structure `i` of `r` and all its substructures, calling `pre`
+ * on each before its substructures and `post` after them (either may
+ * be NULL). If `pre` returns nonzero, the substructures of that one are
+ * skipped; what `post` returns is ignored. It follows the `parent`
+ * links instead of recursing, so any depth is fine.
+ */
+void gedRecord_walk(GedRecord *r, int32_t i, GedNodeVisitor pre, GedNodeVisitor post, void *arg);
+
+/**
+ * Copies structure `i` of `from`, with all its substructures, into `to`
+ * as `gedRecord_add` would add it, and returns its index in `to`. The
+ * copies share their strings with the originals.
+ */
+int32_t gedRecord_copy(GedRecord *to, GedArena *arena, int32_t parent, int32_t prev, const GedRecord *from, int32_t i);
 
 
 /**
@@ -132,6 +200,21 @@ void ged_destroy_structure(GedStructure *r);
  */
 typedef struct GedEmitterTemplate_t {
     void (*emit)(struct GedEmitterTemplate_t *self, GedEvent event);
+    /**
+     * Memory that lives until the current level-0 record has been fully
+     * processed. Use it for `GedRecord` nodes and other per-record
+     * scratch space instead of `malloc`; never free what it returns.
+     */
+    GedArena *arena;
+    /** The options of the conversion in progress; never NULL */
+    const struct GedOptions_t *options;
+    /**
+     * Which run of records is being converted. With more than one
+     * thread, each run is converted with its own copy of the states of
+     * filters without `ordered` (see pipeline/config.h), so anything
+     * such a filter numbers must also be told apart by run; otherwise 0.
+     */
+    size_t run;
 } GedEmitterTemplate;
 
 
@@ -161,21 +244,88 @@ typedef void (*GedFilterFunc)(GedEvent *event, GedEmitterTemplate *emitter, void
 typedef void *(*GedFilterStateMaker)();
 typedef void (*GedFilterStateFreer)(void *);
 
+/**
+ * Callback types for keeping what a filter's first pass learned (see
+ * `GedOptions.cache_dir`). A saver writes the parts of `state` that
+ * the second pass needs to `to`; a loader reads what the saver wrote
+ * into a state fresh from the maker and returns 0, or nonzero if what
+ * it read was not what a saver writes.
+ */
+typedef void (*GedFilterStateSaver)(const void *state, FILE *to);
+typedef int (*GedFilterStateLoader)(void *state, FILE *from);
+
 
 /** a helper for changing data in an event to a non-malloced string */
 void changePayloadToConst(GedEvent *e, const char *val);
 /** a helper for changing data in an event to a malloced string */
 void changePayloadToDynamic(GedEvent *e, char *val);
+/** a helper for changing the tag of a GED_START event to a known tag */
+void changeTagTo(GedEvent *e, int tag);
 
 
 void _show_event(const GedEvent *evt); // debugging helper
 
-#include <stdio.h>
-/** Conversion interface function */
-void ged551to700(FILE *from, FILE *to);
+/**
+ * Settings for one conversion. Zero-initialize and set the fields you
+ * need; a NULL `GedOptions *` means all zeros.
+ */
+typedef struct GedOptions_t {
+    /** if nonzero, omit PHRASE when creating ENUMs */
+    int few_phrases;
+    /** if nonzero, compare xrefs case-insensitively */
+    int xref_case_insensitive;
+    /**
+     * if more than 1, the number of threads to convert records on after
+     * the first pass (where supported)
+     */
+    int threads;
+    /**
+     * if nonzero, read the input only once, spilling most of the output
+     * to a temporary file until HEAD can be written. Implied for input
+     * that cannot be rewound; `threads` does not apply.
+     */
+    int streaming;
+    /**
+     * if not NULL, count what each filter of the pipeline does in each
+     * pass (events in and out, time spent, and bytes allocated in the
+     * arena) and write the totals here as JSON once the conversion ends
+     */
+    FILE *profile;
+    /**
+     * if not NULL, a directory in which to keep what the first pass
+     * learns about each input, named by the input's size and a hash of
+     * its bytes, so that converting the same input again (with any
+     * other options) can skip the first pass. Does not apply to input
+     * that cannot be rewound or to `streaming`.
+     */
+    const char *cache_dir;
+    /**
+     * if nonzero, the most bytes of a text payload to put on one line;
+     * the rest of a longer line goes on CONC lines, split between
+     * characters and not next to a space where possible. GEDCOM 7.0
+     * has no CONC, so this is only for readers that need it.
+     */
+    size_t line_limit;
+} GedOptions;
 
+/**
+ * The type of callbacks that receive converted output: `len` bytes at
+ * `bytes`, which are only valid during the call. Output arrives in
+ * order, in blocks of up to about 64KB.
+ */
+typedef void (*GedWriteFunc)(const char *bytes, size_t len, void *arg);
 
-/** Global flag; if nonzero, omit PHRASE when creating ENUMs */
-extern int ged_few_phrases;
-/** Global flag; if nonzero, compare xrefs case-insensitively */
-extern int ged_xref_case_insensitive;
+/**
+ * Conversion interface function. Returns 0 on success or nonzero if
+ * the input could not be fully parsed (including if it is empty or its
+ * encoding cannot be determined); in that case the output ends with a
+ * `_PARSE_ERROR` record describing why.
+ */
+int ged551to700(FILE *from, FILE *to, const GedOptions *options);
+
+/**
+ * Like `ged551to700`, but converts `len` bytes at `in` (in any of the
+ * encodings `ged551to700` detects) and gives the output to `out`.
+ * Safe to call from several threads at once.
+ */
+int ged551to700_memory(const void *in, size_t len, GedWriteFunc out, void *arg, const GedOptions *options);
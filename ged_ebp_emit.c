@@ -6,28 +6,131 @@
  */
 
 #include <stdlib.h> // calloc/free
+#include <string.h> // memcpy/strlen
 #include "ged_ebp_emit.h"
 #include <assert.h>
 
 
-GedEventSinkState *gedEventSink_create(FILE *out) {
+static void ged_sink_fwrite(const char *bytes, size_t len, void *out) {
+    fwrite(bytes, 1, len, (FILE *)out);
+}
+
+GedEventSinkState *gedEventSink_createCallback(GedWriteFunc write, void *arg) {
     GedEventSinkState *state = calloc(1, sizeof(GedEventSinkState));
-    state->dest = out;
+    state->write = write;
+    state->arg = arg;
+    state->buf = malloc(GED_SINK_BUFFER);
     return state; 
 }
 
+GedEventSinkState *gedEventSink_create(FILE *out) {
+    return gedEventSink_createCallback(ged_sink_fwrite, out);
+}
+
+void gedEventSink_flush(GedEventSinkState *state) {
+    if (state->len) state->write(state->buf, state->len, state->arg);
+    state->len = 0;
+}
+
 void gedEventSink_free(GedEventSinkState *state) { 
+    gedEventSink_flush(state);
+    free(state->buf);
     free(state); 
 }
 
+/// appends `len` bytes to the output buffer, flushing it as needed
+static void ged_sink_write(GedEventSinkState *state, const char *s, size_t len) {
+    if (state->len + len > GED_SINK_BUFFER) {
+        gedEventSink_flush(state);
+        if (len > GED_SINK_BUFFER) {
+            state->write(s, len, state->arg);
+            return;
+        }
+    }
+    memcpy(state->buf + state->len, s, len);
+    state->len += len;
+}
+static inline void ged_sink_puts(GedEventSinkState *state, const char *s) {
+    ged_sink_write(state, s, strlen(s));
+}
+/// appends `n` in decimal
+static void ged_sink_putlevel(GedEventSinkState *state, int n) {
+    if (n < 0) { ged_sink_write(state, "-", 1); n = -n; }
+    char digits[16];
+    char *d = digits + sizeof(digits);
+    do { *(--d) = '0' + n%10; n /= 10; } while (n);
+    ged_sink_write(state, d, digits + sizeof(digits) - d);
+}
+
+#define GED_ENDL_LEN (sizeof(GED_ENDL)-1)
+
+/// ends the current line and starts a `tag` line for more of the payload
+static void ged_sink_continue(GedEventSinkState *state, const char *tag) {
+    ged_sink_write(state, GED_ENDL, GED_ENDL_LEN);
+    ged_sink_putlevel(state, state->level);
+    ged_sink_write(state, " ", 1);
+    ged_sink_puts(state, tag);
+}
+
+/// writes what separates a tag from a text payload line starting with `c`
+static void ged_sink_linestart(GedEventSinkState *state, char c) {
+    if (c == '@')
+        ged_sink_write(state, " @", 2);
+    else 
+        ged_sink_write(state, " ", 1);
+    state->width = 0;
+}
+
+/**
+ * How many of the `len` bytes at `s` (which are more than `room`) to
+ * put on the current line: as many as fit without splitting a UTF-8
+ * character or putting a space on either side of the split, if there
+ * is such a place, but at least one character if `room` is all there
+ * is on the line.
+ */
+static size_t ged_sink_cut(const char *s, size_t len, size_t room, size_t limit) {
+    size_t cut = room;
+    while (cut > 0 && ((s[cut]&0xC0) == 0x80 || s[cut] == ' ' || s[cut-1] == ' '))
+        cut -= 1;
+    if (cut > 0) return cut;
+    cut = room;
+    while (cut > 0 && (s[cut]&0xC0) == 0x80) cut -= 1;
+    if (cut > 0 || room < limit) return cut;
+    do cut += 1; while (cut < len && (s[cut]&0xC0) == 0x80);
+    return cut;
+}
+
+/**
+ * Appends the `len` bytes of text payload at `s`, none of them a line
+ * break, to the current line, moving what passes `line_limit` onto
+ * CONC lines.
+ */
+static void ged_sink_text(GedEventSinkState *state, const char *s, size_t len) {
+    while (state->line_limit && state->width + len > state->line_limit) {
+        size_t room = state->width < state->line_limit ? state->line_limit - state->width : 0;
+        size_t cut = ged_sink_cut(s, len, room, state->line_limit);
+        ged_sink_write(state, s, cut);
+        s += cut;
+        len -= cut;
+        ged_sink_continue(state, "CONC");
+        ged_sink_linestart(state, *s);
+    }
+    ged_sink_write(state, s, len);
+    state->width += len;
+}
+
 void gedEventSinkFunc(GedEvent evt, GedEventSinkState *state) {
 
     if (state->last.type == GED_START) {
         // tags have to wait one step to be output
         // because anchor might follow start
-        if (evt.type == GED_ANCHOR) 
-            fprintf(state->dest, " @%s@", evt.data);
-        fprintf(state->dest, " %s", state->last.data);
+        if (evt.type == GED_ANCHOR) {
+            ged_sink_write(state, " @", 2);
+            ged_sink_puts(state, evt.data);
+            ged_sink_write(state, "@", 1);
+        }
+        ged_sink_write(state, " ", 1);
+        ged_sink_puts(state, state->last.data);
     }
     
     switch(evt.type) {
@@ -35,52 +138,61 @@ void gedEventSinkFunc(GedEvent evt, GedEventSinkState *state) {
             assert(0); // Must not have unused-type events
         } break;
         case GED_START: {
-            fprintf(state->dest, "%s%d",
-                (state->last.type ? (
-                state->last.type == GED_END ? "" : GED_ENDL
-                ) : "\xef\xbb\xbf"), // UTF-8 Byte Order Mark
-                state->level
-            );
+            if (!state->last.type)
+                ged_sink_write(state, "\xef\xbb\xbf", 3); // UTF-8 Byte Order Mark
+            else if (state->last.type != GED_END)
+                ged_sink_write(state, GED_ENDL, GED_ENDL_LEN);
+            ged_sink_putlevel(state, state->level);
             state->level += 1;
             // tag handled on next event
         } break;
         case GED_END: {
             if (state->last.type != GED_END)
-                fprintf(state->dest, GED_ENDL);
+                ged_sink_write(state, GED_ENDL, GED_ENDL_LEN);
             state->level -= 1;
         } break;
         case GED_ANCHOR: {
             // handled before switch
         } break;
         case GED_POINTER: {
-            fprintf(state->dest, " @%s@", evt.data);
+            ged_sink_write(state, " @", 2);
+            ged_sink_puts(state, evt.data);
+            ged_sink_write(state, "@", 1);
         } break;
         case GED_TEXT: {
-            if (state->last.type == GED_TEXT) {
-                fprintf(state->dest, "%s", evt.data);
-            } else {
-                if (evt.data[0] == '@')
-                    fprintf(state->dest, " @%s", evt.data);
-                else 
-                    fprintf(state->dest, " %s", evt.data);
+            // one CONT line after each \n, without copying the payload;
+            // only the first line has a separator even if empty
+            const char *line = evt.data;
+            const char *nl = strchr(line, '\n');
+            if (state->last.type != GED_TEXT && (!nl || nl > line))
+                ged_sink_linestart(state, *line);
+            while (nl) {
+                ged_sink_text(state, line, nl - line);
+                ged_sink_continue(state, "CONT");
+                line = nl + 1;
+                nl = strchr(line, '\n');
+                if (*line && line != nl) ged_sink_linestart(state, *line);
             }
+            ged_sink_text(state, line, strlen(line));
         } break;
         case GED_LINEBREAK: {
-            fprintf(state->dest, "%s%d CONT", GED_ENDL, state->level);
+            ged_sink_continue(state, "CONT");
         } break;
         case GED_EOF: {
+            gedEventSink_flush(state);
         } break;
         case GED_ERROR: {
-            fprintf(state->dest, "%s0 _PARSE_ERROR %s%s", 
-                (state->last.type == GED_END ? "" : GED_ENDL),
-                evt.data, GED_ENDL
-            );
+            if (state->last.type != GED_END)
+                ged_sink_write(state, GED_ENDL, GED_ENDL_LEN);
+            ged_sink_write(state, "0 _PARSE_ERROR ", 15);
+            ged_sink_puts(state, evt.data);
+            ged_sink_write(state, GED_ENDL, GED_ENDL_LEN);
         } break;
         case GED_RECORD: {
-            fprintf(state->dest, "%s0 _PARSE_ERROR <record>%s", 
-                (state->last.type == GED_END ? "" : GED_ENDL),
-                GED_ENDL
-            );
+            if (state->last.type != GED_END)
+                ged_sink_write(state, GED_ENDL, GED_ENDL_LEN);
+            ged_sink_write(state, "0 _PARSE_ERROR <record>", 23);
+            ged_sink_write(state, GED_ENDL, GED_ENDL_LEN);
         } break;
     }
     ged_destroy_event(&(state->last));
@@ -22,15 +22,32 @@
  * Dumps the events as a GEDCOM stream. It performs no validation,
  * assumes all IDs and tags are already handled, 
  * and uses `GED_ENDL` for line terminators.
+ * 
+ * Output is collected in `buf` and given to `write` one call per
+ * GED_SINK_BUFFER bytes; it is flushed on GED_EOF and when freed.
+ * 
+ * Each "\n" in a GED_TEXT becomes a CONT line, written straight from
+ * the event's data; GED_LINEBREAK events are also accepted.
  */
 typedef struct {
-    FILE *dest;
+    GedWriteFunc write; void *arg; // where output goes
     int level;
     GedEvent last; 
+    char *buf; size_t len;
+    size_t width; // bytes of payload on the current line so far
+    size_t line_limit; // see `GedOptions.line_limit`; 0 for none
 } GedEventSinkState;
 
+#define GED_SINK_BUFFER (1<<16)
+
+/// a sink that writes to `out` with `fwrite`
 GedEventSinkState *gedEventSink_create(FILE *out);
-void gedEventSink_free(GedEventSinkState *state);
+/// a sink that gives its output to `write`, passing it `arg`
+GedEventSinkState *gedEventSink_createCallback(GedWriteFunc write, void *arg);
+void gedEventSink_free(GedEventSinkState *state); // flushes first
+
+/// gives all buffered output to `write` (but does not `fflush` a FILE)
+void gedEventSink_flush(GedEventSinkState *state);
 
 /**
  * Consumes all events, printing out as GEDCOM
@@ -8,8 +8,10 @@
 #include <stdlib.h> // for calloc and free
 #include <stddef.h> // for ptrdiff_t
 #include <ctype.h>  // for isspace
+#include <string.h> // for memcpy, strlen, strcspn
 
 #include "ged_ebp_parse.h"
+#include "gedscan.h"
 
 typedef enum {
     GED_PRE_LEVEL = 0, // between newline and level
@@ -20,52 +22,77 @@ typedef enum {
 
 
 /**
- * reads from `s` into a malloced string `*dest`, `realloc`ing
- * as needed, stopping at the first character in delims or an 
- * error, whichever comes first. Unlike `getdelim`, it does not
- * include the delimiter in `*dest`, instead returning it.
+ * reads from `s` into the scratch buffer `state->line`, starting at
+ * index `*len` and growing the buffer as needed, stopping at the first
+ * character in delims (at most four) or an error, whichever comes
+ * first. Unlike `getdelim`, it does not include the delimiter, instead
+ * returning it.
  * 
- * If `*dest` already has a string, this concatenates to it.
+ * Updates `*len` to the length of the line, which is not null-terminated.
  */
-int getUTF8Delim(char **dest, const char *delims, DecodingFileReader *s) {
-    size_t cap = 16, len = 0;
-    if (*dest) {
-        while((*dest)[len]) {
-            len += 1;
-            if (len >= cap) cap*=2;
-        }
-    }
-    *dest = realloc(*dest, cap);
+int getUTF8Delim(GedEventSourceState *state, size_t *len, const char *delims) {
     int byte;
     for(;;) {
-        byte = nextUTF8byte(s);
-        if (byte < 0) goto cleanup;
-        for(const char *d = delims; *d; d+=1) if (byte == *d) goto cleanup;
-        if (len == cap) {
-            cap *= 2;
-            *dest = realloc(*dest, cap);
+        const char *span;
+        long n = nextUTF8span(state->reader, &span);
+        if (n < 0) { byte = n; break; }
+        long i = gedScan_delim(span, n, delims);
+        if (*len + i >= state->linecap) {
+            while (*len + i >= state->linecap) state->linecap *= 2;
+            state->line = realloc(state->line, state->linecap);
+        }
+        memcpy(state->line + *len, span, i);
+        *len += i;
+        if (i < n) {
+            byte = (unsigned char)span[i];
+            decodingFileReader_skip(state->reader, i+1);
+            break;
         }
-        (*dest)[len++] = byte;
+        decodingFileReader_skip(state->reader, i);
     }
-    cleanup:
-    *dest = realloc(*dest, len+1);
-    (*dest)[len] = 0;
     return byte;
 }
 
 
-GedEventSourceState *gedEventSource_create(FILE *in) {
+/// allocates everything but the reader's input
+static GedEventSourceState *gedEventSource_alloc() {
     GedEventSourceState *state = calloc(1, sizeof(GedEventSourceState));
     state->reader = calloc(1, sizeof(DecodingFileReader));
+    state->arena = gedArena_create();
+    state->tags = gedTagTable_create();
+    state->linecap = 256;
+    state->line = malloc(state->linecap);
     state->lastLevel = -1;
-    int status = decodingFileReader_init(state->reader, in);
-    if (status)
-        fprintf(stderr, "Error code initializing reader %d\n", status);
+    return state;
+}
+
+GedEventSourceState *gedEventSource_create(FILE *in) {
+    GedEventSourceState *state = gedEventSource_alloc();
+    int status = decodingFileReader_initMapped(state->reader, in);
+    if (status < 0) status = decodingFileReader_init(state->reader, in);
+    state->status = status;
+    return state;
+}
+
+GedEventSourceState *gedEventSource_createMemory(const void *data, size_t len) {
+    GedEventSourceState *state = gedEventSource_alloc();
+    state->status = decodingFileReader_initMemory(state->reader, data, len);
+    return state;
+}
+
+GedEventSourceState *gedEventSource_createUTF8(const char *data, size_t len, int end) {
+    GedEventSourceState *state = gedEventSource_alloc();
+    decodingFileReader_initUTF8(state->reader, data, len, end);
+    state->keep = 1;
     return state;
 }
 
 void gedEventSource_free(GedEventSourceState *state) {
+    decodingFileReader_destroy(state->reader);
     free(state->reader);
+    gedArena_free(state->arena);
+    gedTagTable_free(state->tags);
+    free(state->line);
     free(state);
 }
 
@@ -73,6 +100,7 @@ void gedEventSource_free(GedEventSourceState *state) {
 GedEvent gedEventSource_get(GedEventSourceState *state) {
     GedEvent result;
     result.flags = 0;
+    result.tag = GED_TAG_NONE;
     result.data = 0;
 
 #define GED_SE_ERR(msg) do { \
@@ -85,15 +113,14 @@ GedEvent gedEventSource_get(GedEventSourceState *state) {
     if (state->anchor) {
         result.type = GED_ANCHOR;
         result.data = state->anchor;
-        result.flags = GED_OWNS_DATA;
         state->anchor = 0;
         return result;
     }
 
     switch(state->stage) {
         case GED_PRE_LEVEL: { // post-newline pre-level
-            int b = nextCodepoint(state->reader);
-            while (isspace(b)) b = nextCodepoint(state->reader);
+            int b = nextUTF8byte(state->reader);
+            while (isspace(b)) b = nextUTF8byte(state->reader);
             if (b == -1) {
                 if (state->lastLevel >= 0) {
                     result.type = GED_END;
@@ -110,7 +137,7 @@ GedEvent gedEventSource_get(GedEventSourceState *state) {
             int level = 0;
             while (b >= '0' && b <= '9') {
                 level = (level*10) + (b-'0');
-                b = nextCodepoint(state->reader);
+                b = nextUTF8byte(state->reader);
                 if (b == -1) GED_SE_ERR("File ended mid-line");
                 if (b < 0) GED_SE_ERR("Encountered non-character bytes");
             }
@@ -126,34 +153,40 @@ GedEvent gedEventSource_get(GedEventSourceState *state) {
             }
             state->lastLevel = state->inLevel;
             state->stage = GED_PRE_PAYLOAD;
+            
+            // every event of the previous record has been fully
+            // processed, so its strings can be discarded
+            if (state->inLevel == 0 && !state->keep) gedArena_reset(state->arena);
 
             // read xref:id (if any) and tag
-            int b = nextCodepoint(state->reader);
-            while (isspace(b)) b = nextCodepoint(state->reader);
+            int b = nextUTF8byte(state->reader);
+            while (isspace(b)) b = nextUTF8byte(state->reader);
             if (b == -1) GED_SE_ERR("File ended mid-line");
             if (b < 0) GED_SE_ERR("Encountered non-character bytes");
+            size_t len = 0;
             if (b == '@') { // xref:id
-                b = getUTF8Delim(&(state->anchor), "@\n\r", state->reader);
-                if (b != '@') {
-                    free(state->anchor); state->anchor = 0;
-                    GED_SE_ERR("unterminated XREF_ID");
-                }
-                b = nextCodepoint(state->reader);
-                while (isspace(b)) b = nextCodepoint(state->reader);
+                b = getUTF8Delim(state, &len, "@\n\r");
+                if (b != '@') GED_SE_ERR("unterminated XREF_ID");
+                state->anchor = gedArena_strndup(state->arena, state->line, len);
+                len = 0;
+                b = nextUTF8byte(state->reader);
+                while (isspace(b)) b = nextUTF8byte(state->reader);
                 if (b == -1) GED_SE_ERR("File ended mid-line");
                 if (b < 0) GED_SE_ERR("Encountered non-character bytes");
             }
             // tag
-            char *ans = malloc(16);
-            ans[0] = b; ans[1] = 0;
-            b = getUTF8Delim(&ans, " \t\n\r", state->reader);
+            state->line[len++] = b;
+            b = getUTF8Delim(state, &len, " \t\n\r");
             if (b == '\n' || b == '\r') state->stage = GED_PRE_LEVEL;
             else if (b == -1) state->stage = GED_POST_TRLR;
             else if (b < 0) GED_SE_ERR("Encountered non-character bytes");
             
             result.type = GED_START;
-            result.data = ans;
-            result.flags = GED_OWNS_DATA;
+            state->line[len] = 0;
+            const char *name;
+            result.tag = gedTagTable_intern(state->tags, state->line, &name);
+            if (result.tag) result.data = (char *)name;
+            else result.data = gedArena_strndup(state->arena, state->line, len);
             return result;
         } break;
         
@@ -167,12 +200,15 @@ GedEvent gedEventSource_get(GedEventSourceState *state) {
             // remaining @ unchanged
             state->stage = GED_PRE_LEVEL;
             // first get the raw characters
-            char *payload = 0;
-            int b = getUTF8Delim(&payload, "\n\r", state->reader);
+            size_t len = 0;
+            int b = getUTF8Delim(state, &len, "\n\r");
             if (b == -1) state->stage = GED_POST_TRLR;
             else if (b < 0) GED_SE_ERR("Encountered non-character bytes");
+            char *payload = state->line;
+            payload[len] = 0; // getUTF8Delim leaves room for this
             // then loop through looking for @ pairs
-            ptrdiff_t r=0, w=0, lastAt = -2;
+            // nothing changes before the first @, so start there
+            ptrdiff_t r=strcspn(payload, "@"), w=r, lastAt = -2;
             int esc = 0, ats=0;
             for(;payload[r];r+=1) {
                 if (payload[r] != '@' || lastAt < 0) {
@@ -211,19 +247,12 @@ GedEvent gedEventSource_get(GedEventSourceState *state) {
             payload[w] = 0;
             if (ats == 2 && payload[0] == '@' && payload[w-1] == '@') {
                 // pointer
-                for(r=1; r<w-1; r+=1)
-                    payload[r-1] = payload[r];
-                payload[r-1] = 0;
-                payload = realloc(payload, r);
                 result.type = GED_POINTER;
-                result.data = payload;
-                result.flags = GED_OWNS_DATA;
+                result.data = gedArena_strndup(state->arena, payload+1, w > 1 ? w-2 : 0);
                 return result;
             }
-            else if (r != w) payload = realloc(payload, w+1);
             result.type = GED_TEXT;
-            result.data = payload;
-            result.flags = GED_OWNS_DATA;
+            result.data = gedArena_strndup(state->arena, payload, w);
             return result;
         }; break;
         
@@ -246,7 +275,13 @@ GedEvent gedEventSource_get(GedEventSourceState *state) {
 /// reset internal state so _get will return the first event next
 void gedEventSource_rewind(GedEventSourceState *state) {
     decodingFileReader_rewind(state->reader);
+    gedArena_reset(state->arena);
+    state->anchor = 0;
     state->stage = GED_PRE_LEVEL;
     state->lastLevel = -1;
     state->inLevel = 0;
 }
+
+int gedEventSource_canRewind(GedEventSourceState *state) {
+    return decodingFileReader_canRewind(state->reader);
+}
@@ -10,17 +10,56 @@
 
 #include "ged_ebp.h"
 #include "ansel2utf8.h"
+#include "gedarena.h"
+#include "gedtag.h"
 
+/**
+ * The `data` of events returned by `gedEventSource_get` is not owned
+ * by the event; it lives in `arena`, which is reset when the next
+ * record begins, and may be modified in place by filters.
+ * 
+ * The exception is a GED_START whose `tag` is set: its `data` is the
+ * interned spelling from `tags`, shared by every event with that tag,
+ * and must not be modified.
+ * 
+ * If `keep` is set, `arena` is never reset, so the strings of every
+ * record live until the state is freed.
+ */
 typedef struct {
     DecodingFileReader *reader;
     int stage; 
     int inLevel, lastLevel;
     char *anchor;
+    GedArena *arena; // strings of the current record
+    GedTagTable *tags; // interned tags of the entire input
+    char *line; size_t linecap; // scratch space for reading tokens
+    int keep; // nonzero to keep all records' strings in `arena`
+    int status; // from initializing `reader`; nonzero if it cannot be read
 } GedEventSourceState;
 
-/// allocate and initialize reading state
+/**
+ * Allocate and initialize reading state; memory-maps `in` if possible.
+ * Sets `status` nonzero if the encoding of `in` cannot be determined;
+ * there is then nothing to read.
+ */
 GedEventSourceState *gedEventSource_create(FILE *in);
 
+/**
+ * Allocate and initialize reading state for `len` bytes at `data`,
+ * detecting their encoding as `gedEventSource_create` does; `data`
+ * must outlive the state.
+ */
+GedEventSourceState *gedEventSource_createMemory(const void *data, size_t len);
+
+/**
+ * Allocate and initialize reading state for `len` bytes of UTF-8 at
+ * `data`: a run of whole records cut from a larger, already-decoded
+ * input. `end` is what the input's reader reported after those bytes
+ * (EOF or an encoding error). The state sets `keep`; `data` must
+ * outlive it.
+ */
+GedEventSourceState *gedEventSource_createUTF8(const char *data, size_t len, int end);
+
 /// deallocate reading state
 void gedEventSource_free(GedEventSourceState *state);
 
@@ -30,3 +69,6 @@ GedEvent gedEventSource_get(GedEventSourceState *state);
 
 /// reset internal state so _get will return the first event next
 void gedEventSource_rewind(GedEventSourceState *state);
+
+/// 1 if `gedEventSource_rewind` works; 0 if the input is a pipe or the like
+int gedEventSource_canRewind(GedEventSourceState *state);
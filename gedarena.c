@@ -0,0 +1,89 @@
+/**
+ * Implementation of the bump allocator declared in gedarena.h
+ * 
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy, memset
+#include "gedarena.h"
+
+/// size of a typical block; larger requests get a block of their own
+#define GED_ARENA_BLOCK (1<<16)
+
+/// every gedArena_alloc result is a multiple of this
+#define GED_ARENA_ALIGN (sizeof(void *) > sizeof(double) ? sizeof(void *) : sizeof(double))
+
+struct gedArena_block_t {
+    struct gedArena_block_t *next;
+    size_t used, cap;
+    double data[]; // double to align the first allocation
+};
+
+GedArena *gedArena_create() {
+    return calloc(1, sizeof(GedArena));
+}
+
+void gedArena_free(GedArena *a) {
+    gedArena_block *b = a->first;
+    while (b) {
+        gedArena_block *tmp = b;
+        b = b->next;
+        free(tmp);
+    }
+    free(a);
+}
+
+void gedArena_reset(GedArena *a) {
+    for(gedArena_block *b = a->first; b; b = b->next) b->used = 0;
+    a->cur = a->first;
+}
+
+/**
+ * Returns `n` bytes from the current block, moving on to later blocks
+ * (reused after a reset, or newly allocated) if it is too full.
+ */
+static char *gedArena_bump(GedArena *a, size_t n) {
+    while (a->cur && a->cur->used + n > a->cur->cap) {
+        if (!a->cur->next) break;
+        a->cur = a->cur->next;
+    }
+    if (!a->cur || a->cur->used + n > a->cur->cap) {
+        size_t cap = n > GED_ARENA_BLOCK ? n : GED_ARENA_BLOCK;
+        gedArena_block *b = malloc(sizeof(gedArena_block) + cap);
+        b->used = 0;
+        b->cap = cap;
+        if (a->cur) {
+            b->next = a->cur->next;
+            a->cur->next = b;
+        } else {
+            b->next = 0;
+            a->first = b;
+        }
+        a->cur = b;
+    }
+    char *ans = (char *)a->cur->data + a->cur->used;
+    a->cur->used += n;
+    a->allocated += n;
+    return ans;
+}
+
+void *gedArena_alloc(GedArena *a, size_t n) {
+    if (a->cur) // round the bump pointer up to alignment
+        a->cur->used = (a->cur->used + GED_ARENA_ALIGN-1) & ~(GED_ARENA_ALIGN-1);
+    return gedArena_bump(a, n);
+}
+
+void *gedArena_calloc(GedArena *a, size_t n) {
+    void *ans = gedArena_alloc(a, n);
+    memset(ans, 0, n);
+    return ans;
+}
+
+char *gedArena_strndup(GedArena *a, const char *s, size_t n) {
+    char *ans = gedArena_bump(a, n+1);
+    memcpy(ans, s, n);
+    ans[n] = 0;
+    return ans;
+}
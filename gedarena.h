@@ -0,0 +1,44 @@
+/**
+ * A bump allocator for data that all dies at the same time, such as
+ * the strings and structures of a single GEDCOM record.
+ * 
+ * GedArena *a = gedArena_create();
+ * char *s = gedArena_strndup(a, "hello", 5);
+ * gedArena_reset(a);    // s is now invalid; memory is kept for reuse
+ * gedArena_free(a);     // returns all memory to the system
+ * 
+ * Allocations are never moved, so pointers stay valid until the next
+ * `gedArena_reset` or `gedArena_free`.
+ * 
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+#pragma once
+
+#include <stddef.h> // size_t
+
+typedef struct gedArena_block_t gedArena_block;
+
+typedef struct {
+    gedArena_block *first; // all blocks, in allocation order
+    gedArena_block *cur;   // the block currently being allocated from
+    size_t allocated;      // bytes handed out since creation, resets and all
+} GedArena;
+
+/// allocates a new, empty arena
+GedArena *gedArena_create();
+
+/// frees the arena and everything ever allocated in it
+void gedArena_free(GedArena *a);
+
+/// invalidates everything allocated in the arena, keeping its memory
+void gedArena_reset(GedArena *a);
+
+/// returns `n` bytes suitably aligned for any structure
+void *gedArena_alloc(GedArena *a, size_t n);
+
+/// returns `n` zero bytes suitably aligned for any structure
+void *gedArena_calloc(GedArena *a, size_t n);
+
+/// copies `n` bytes of `s` into the arena and adds a null terminator
+char *gedArena_strndup(GedArena *a, const char *s, size_t n);
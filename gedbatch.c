@@ -0,0 +1,234 @@
+/**
+ * Batch conversion; see gedbatch.h.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+
+#include <stdlib.h> // for malloc, realloc, and free
+#include <string.h> // for strlen, strcpy, and strrchr
+#include <ctype.h>  // for tolower
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#include <threads.h>
+#define GED_HAVE_THREADS
+#endif
+
+#ifdef _WIN32
+#include <windows.h> // FindFirstFileA
+#elif defined(__unix__) || defined(__APPLE__)
+#define GED_HAVE_DIRENT
+#include <dirent.h> // opendir
+#endif
+
+#include "gedbatch.h"
+#include "ansel2utf8.h" // decodingFileReader_init, to check inputs before converting
+
+
+/// adds a copy of `path`, or of `dir` and `name` joined by a separator
+static void ged_batch_push(GedBatch *b, const char *dir, const char *name) {
+    if (b->count >= b->cap) {
+        b->cap = b->cap ? b->cap*2 : 64;
+        b->inputs = realloc(b->inputs, sizeof(char *)*b->cap);
+    }
+    size_t n = dir ? strlen(dir) : 0;
+    char *path = malloc(n + 1 + strlen(name) + 1);
+    if (dir) {
+        strcpy(path, dir);
+        path[n++] = '/';
+    }
+    strcpy(path + n, name);
+    b->inputs[b->count++] = path;
+}
+
+/// 1 if `name` ends in `.ged` in any case
+static int ged_batch_isged(const char *name) {
+    size_t n = strlen(name);
+    if (n < 4 || name[n-4] != '.') return 0;
+    return tolower(name[n-3]) == 'g' && tolower(name[n-2]) == 'e' && tolower(name[n-1]) == 'd';
+}
+
+int gedBatch_add(GedBatch *b, const char *path) {
+#ifdef _WIN32
+    DWORD attr = GetFileAttributesA(path);
+    if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY)) {
+        size_t n = strlen(path);
+        char *pattern = malloc(n + 3);
+        strcpy(pattern, path);
+        strcpy(pattern + n, "\\*");
+        WIN32_FIND_DATAA found;
+        HANDLE h = FindFirstFileA(pattern, &found);
+        free(pattern);
+        if (h == INVALID_HANDLE_VALUE) return 1;
+        do {
+            if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && ged_batch_isged(found.cFileName))
+                ged_batch_push(b, path, found.cFileName);
+        } while (FindNextFileA(h, &found));
+        FindClose(h);
+        return 0;
+    }
+#elif defined(GED_HAVE_DIRENT)
+    DIR *d = opendir(path);
+    if (d) {
+        struct dirent *ent;
+        while ((ent = readdir(d)))
+            if (ent->d_name[0] != '.' && ged_batch_isged(ent->d_name))
+                ged_batch_push(b, path, ent->d_name);
+        closedir(d);
+        return 0;
+    }
+#endif
+    ged_batch_push(b, 0, path); // not a directory, or unable to tell
+    return 0;
+}
+
+void gedBatch_addList(GedBatch *b, FILE *list) {
+    char line[4096];
+    while (fgets(line, sizeof(line), list)) {
+        size_t n = strlen(line);
+        while (n > 0 && (line[n-1] == '\n' || line[n-1] == '\r')) line[--n] = 0;
+        if (n) gedBatch_add(b, line);
+    }
+}
+
+void gedBatch_free(GedBatch *b) {
+    for(size_t i=0; i<b->count; i+=1) free(b->inputs[i]);
+    free(b->inputs);
+    b->inputs = 0;
+    b->count = b->cap = 0;
+}
+
+
+/// the file name part of `path`, which is also that of its output
+static const char *ged_batch_name(const char *path) {
+    const char *name = path;
+    for(const char *p = path; *p; p+=1)
+        if (*p == '/' || *p == '\\') name = p+1;
+    return name;
+}
+
+/// converts one input; returns 0, or what went wrong
+static const char *ged_batch_convert(GedBatch *b, const char *path) {
+    const char *name = ged_batch_name(path);
+
+    FILE *from = fopen(path, "rb");
+    if (!from) return "unable to read";
+    
+    // make no output for input that is not GEDCOM at all
+    DecodingFileReader r;
+    int status = decodingFileReader_init(&r, from);
+    decodingFileReader_destroy(&r);
+    rewind(from);
+    if (status) {
+        fclose(from);
+        return decodingFileReader_error(status);
+    }
+    
+    size_t n = strlen(b->outdir);
+    char *outpath = malloc(n + 1 + strlen(name) + 1);
+    strcpy(outpath, b->outdir);
+    outpath[n] = '/';
+    strcpy(outpath + n + 1, name);
+    FILE *to = fopen(outpath, b->overwrite ? "wb" : "wxb");
+    free(outpath);
+    if (!to) {
+        fclose(from);
+        return "unable to write output (does it already exist?)";
+    }
+
+    GedOptions options = b->options;
+    options.threads = 1; // the batch is already spread across threads
+    options.profile = 0; // reports from concurrent files would interleave
+    int failed = ged551to700(from, to, &options);
+    fclose(from);
+    if (fclose(to)) return "unable to write output";
+    return failed ? "parse error" : 0;
+}
+
+struct ged_batch_pool {
+    GedBatch *batch;
+    FILE *report;
+    char *clash; // for each input, 1 if another has the same output
+    size_t next, failed;
+#ifdef GED_HAVE_THREADS
+    mtx_t lock; // for all the fields above
+#endif
+};
+
+/// converts inputs, one at a time, until there are none left
+static int ged_batch_worker(void *arg) {
+    struct ged_batch_pool *pool = (struct ged_batch_pool *)arg;
+    for(;;) {
+#ifdef GED_HAVE_THREADS
+        mtx_lock(&pool->lock);
+#endif
+        size_t i = pool->next;
+        if (i < pool->batch->count) pool->next += 1;
+#ifdef GED_HAVE_THREADS
+        mtx_unlock(&pool->lock);
+#endif
+        if (i >= pool->batch->count) break;
+
+        const char *error = pool->clash[i]
+            ? "another input has the same file name, so the same output"
+            : ged_batch_convert(pool->batch, pool->batch->inputs[i]);
+
+#ifdef GED_HAVE_THREADS
+        mtx_lock(&pool->lock);
+#endif
+        if (error) {
+            fprintf(pool->report, "ERROR\t%s\t%s\n", pool->batch->inputs[i], error);
+            pool->failed += 1;
+        } else {
+            fprintf(pool->report, "OK\t%s\n", pool->batch->inputs[i]);
+        }
+#ifdef GED_HAVE_THREADS
+        mtx_unlock(&pool->lock);
+#endif
+    }
+    return 0;
+}
+
+/// compares the file names of two `char *const *`, ignoring case as some file systems do
+static int ged_batch_namecmp(const void *a, const void *b) {
+    const unsigned char *x = (const unsigned char *)ged_batch_name(**(char *const *const *)a);
+    const unsigned char *y = (const unsigned char *)ged_batch_name(**(char *const *const *)b);
+    for(; *x && tolower(*x) == tolower(*y); x+=1, y+=1);
+    return tolower(*x) - tolower(*y);
+}
+
+/// marks in `clash` each input whose output another input's would overwrite
+static void ged_batch_clashes(const GedBatch *b, char *clash) {
+    char ***sorted = malloc(sizeof(char **)*(b->count ? b->count : 1)); // into `inputs`
+    for(size_t i=0; i<b->count; i+=1) sorted[i] = b->inputs + i;
+    qsort(sorted, b->count, sizeof(char **), ged_batch_namecmp);
+    for(size_t i=1; i<b->count; i+=1)
+        if (!ged_batch_namecmp(sorted + i-1, sorted + i))
+            clash[sorted[i-1] - b->inputs] = clash[sorted[i] - b->inputs] = 1;
+    free(sorted);
+}
+
+size_t gedBatch_run(GedBatch *b, FILE *report) {
+    struct ged_batch_pool pool = {0};
+    pool.batch = b;
+    pool.report = report;
+    pool.clash = calloc(b->count ? b->count : 1, 1);
+    ged_batch_clashes(b, pool.clash);
+#ifdef GED_HAVE_THREADS
+    mtx_init(&pool.lock, mtx_plain);
+    int jobs = b->jobs;
+    if ((size_t)jobs > b->count) jobs = (int)b->count;
+    thrd_t *threads = malloc(sizeof(thrd_t)*(jobs > 1 ? jobs : 1));
+    for(int i=1; i<jobs; i+=1)
+        thrd_create(threads + i, ged_batch_worker, &pool);
+    ged_batch_worker(&pool); // the calling thread is one of the jobs
+    for(int i=1; i<jobs; i+=1)
+        thrd_join(threads[i], 0);
+    free(threads);
+    mtx_destroy(&pool.lock);
+#else
+    ged_batch_worker(&pool);
+#endif
+    free(pool.clash);
+    return pool.failed;
+}
@@ -0,0 +1,59 @@
+/**
+ * Batch conversion: many files in one process, several at a time.
+ *
+ * GedBatch b = {0};
+ * b.outdir = "out";
+ * b.jobs = 8;
+ * gedBatch_add(&b, "trees");       // every .ged file in a directory
+ * gedBatch_add(&b, "one.ged");     // or a single file
+ * gedBatch_addList(&b, stdin);     // or one path per line
+ * size_t failed = gedBatch_run(&b, stdout);
+ * gedBatch_free(&b);
+ *
+ * Each input is converted to the file of the same name in `outdir`.
+ * Inputs that share a name (ignoring case) are refused, not written
+ * over one another, as are inputs that are not GEDCOM at all.
+ * The filters' look-up tables are constant data shared by every
+ * conversion, so a small file costs little more than reading and
+ * writing it.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+#pragma once
+
+#include <stdio.h>  // FILE
+#include <stddef.h> // size_t
+#include "ged_ebp.h" // GedOptions
+
+typedef struct {
+    char **inputs; size_t count, cap; // paths of the files to convert
+    const char *outdir; // where to put the converted files
+    int overwrite; // if nonzero, replace files already in `outdir`
+    int jobs; // how many files to convert at once (where supported)
+    GedOptions options; // for each conversion; `threads` and `profile` are ignored
+} GedBatch;
+
+/**
+ * Adds `path` to the inputs if it is a file, or every file in it whose
+ * name ends `.ged` (in any case) if it is a directory, not recursively.
+ * Returns 0, or nonzero if `path` is a directory that cannot be read.
+ */
+int gedBatch_add(GedBatch *b, const char *path);
+
+/// adds each non-empty line of `list` as `gedBatch_add` does
+void gedBatch_addList(GedBatch *b, FILE *list);
+
+/**
+ * Converts every input, `jobs` at a time, printing one line to
+ * `report` as each is done: `OK` or `ERROR`, a tab, the input's path,
+ * and for errors a tab and what went wrong. Returns the number of
+ * inputs with errors. An input that is empty or whose encoding cannot
+ * be determined, or that shares its name with another input, makes no
+ * output; one that fails to parse part way leaves output ending with a
+ * `_PARSE_ERROR` record.
+ */
+size_t gedBatch_run(GedBatch *b, FILE *report);
+
+/// frees the list of inputs (but not `b`)
+void gedBatch_free(GedBatch *b);
@@ -0,0 +1,367 @@
+/**
+ * Record offset index; see gedindex.h.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+
+#define _POSIX_C_SOURCE 200809L // for fseeko and ftello
+#define _FILE_OFFSET_BITS 64 // so that they take 64-bit offsets everywhere
+
+#include <stdlib.h> // for malloc, calloc, realloc, free, and strtoll
+#include <string.h> // for memcpy, memset, and strlen
+#include <inttypes.h> // for PRId64
+#include "gedindex.h"
+#include "gedscan.h" // gedScan_delim
+
+/// bytes of the file read at a time while building an index
+#define GED_INDEX_BLOCK (1<<16)
+
+/// the first line of every saved index; change it when the format changes
+#define GED_INDEX_MAGIC "ged5to7 index 1\n"
+
+
+/// moves `in` to `offset` bytes from the start, as fseek would, past 2GB
+static int ged_index_seek(FILE *in, int64_t offset, int whence) {
+#ifdef _WIN32
+    return _fseeki64(in, offset, whence);
+#else
+    return fseeko(in, (off_t)offset, whence);
+#endif
+}
+
+/// bytes per code unit of `format`
+static int ged_index_width(Codec format) {
+    if (format == UTF16LE || format == UTF16BE) return 2;
+    if (format == UTF32LE || format == UTF32BE) return 4;
+    return 1;
+}
+
+/// the code unit of `format` at `p`
+static unsigned long ged_index_unit(const unsigned char *p, Codec format) {
+    switch(format) {
+        case UTF16LE: return p[0] | (p[1]<<8);
+        case UTF16BE: return (p[0]<<8) | p[1];
+        case UTF32LE: return p[0] | (p[1]<<8) | ((unsigned long)p[2]<<16) | ((unsigned long)p[3]<<24);
+        case UTF32BE: return ((unsigned long)p[0]<<24) | ((unsigned long)p[1]<<16) | (p[2]<<8) | p[3];
+        default: return p[0];
+    }
+}
+
+/// writes ASCII `s` at `p` in `format`; returns the number of bytes written
+static size_t ged_index_encode(unsigned char *p, const char *s, Codec format) {
+    int w = ged_index_width(format);
+    int le = (format == UTF16LE || format == UTF32LE);
+    size_t n = 0;
+    for(; *s; s+=1, n+=w) {
+        memset(p+n, 0, w);
+        p[n + (le ? 0 : w-1)] = *s;
+    }
+    return n;
+}
+
+/// a copy of the `n` bytes at `s` with a null terminator
+static char *ged_index_strndup(const char *s, size_t n) {
+    char *ans = malloc(n+1);
+    memcpy(ans, s, n);
+    ans[n] = 0;
+    return ans;
+}
+
+static void ged_index_add(GedIndex *ix, int64_t offset, char *xref) {
+    if (ix->count >= ix->cap) {
+        ix->cap = ix->cap ? ix->cap*2 : 1024;
+        ix->records = realloc(ix->records, sizeof(GedIndexRecord)*ix->cap);
+    }
+    ix->records[ix->count].offset = offset;
+    ix->records[ix->count].xref = xref;
+    ix->count += 1;
+}
+
+/// makes `byxref`, once `records` will no longer move
+static void ged_index_finish(GedIndex *ix) {
+    ix->byxref.t = 0;
+    for(size_t i=0; i<ix->count; i+=1)
+        if (ix->records[i].xref)
+            trie_put(&ix->byxref, ix->records[i].xref, ix->records + i);
+}
+
+void gedIndex_free(GedIndex *ix) {
+    for(size_t i=0; i<ix->count; i+=1) free(ix->records[i].xref);
+    free(ix->records);
+    trie_free(&ix->byxref);
+    ix->records = 0;
+    ix->count = ix->cap = 0;
+}
+
+/// the size of `in` in bytes, or -1 if it cannot be told
+static int64_t ged_index_size(FILE *in) {
+    if (ged_index_seek(in, 0, SEEK_END)) return -1;
+#ifdef _WIN32
+    return _ftelli64(in);
+#else
+    return ftello(in);
+#endif
+}
+
+
+/// where in a line the scan is, carried from one block to the next
+struct ged_index_scan {
+    enum {
+        GED_SCAN_LINE,  // past anything that matters in this line
+        GED_SCAN_START, // at the start of a line
+        GED_SCAN_INDENT,// in whitespace at the start of a line
+        GED_SCAN_ZERO,  // just after a level of 0
+        GED_SCAN_SPACE, // after the level, before an xref
+        GED_SCAN_XREF,  // inside an xref
+    } state;
+    int64_t zero; // offset of the start of the level's line
+    char xref[256]; size_t len;
+};
+
+/// scans the `n` bytes at `p`, which are at offset `base` of the file
+static void ged_index_scan(GedIndex *ix, struct ged_index_scan *sc, const unsigned char *p, size_t n, int64_t base) {
+    int w = ged_index_width(ix->format);
+    size_t i = 0;
+    while (i + w <= n) {
+        if (sc->state == GED_SCAN_LINE && w == 1) {
+            i += gedScan_delim((const char *)p + i, n - i, "\n\r");
+            if (i >= n) break;
+        }
+        unsigned long u = ged_index_unit(p + i, ix->format);
+        if (u == '\n' || u == '\r') {
+            sc->state = GED_SCAN_START;
+        } else switch(sc->state) {
+            case GED_SCAN_START: // the parser skips whitespace before the level
+                sc->zero = base + (int64_t)i;
+                // fall through
+            case GED_SCAN_INDENT:
+                if (u == ' ' || u == '\t') sc->state = GED_SCAN_INDENT;
+                else sc->state = (u == '0') ? GED_SCAN_ZERO : GED_SCAN_LINE;
+                break;
+            case GED_SCAN_ZERO:
+                sc->state = GED_SCAN_LINE;
+                if (u == ' ' || u == '\t') {
+                    ged_index_add(ix, sc->zero, 0);
+                    sc->state = GED_SCAN_SPACE;
+                }
+                break;
+            case GED_SCAN_SPACE:
+                if (u == '@') {
+                    sc->len = 0;
+                    sc->state = GED_SCAN_XREF;
+                } else if (u != ' ' && u != '\t') {
+                    sc->state = GED_SCAN_LINE;
+                }
+                break;
+            case GED_SCAN_XREF:
+                if (u == '@') {
+                    if (sc->len)
+                        ix->records[ix->count-1].xref = ged_index_strndup(sc->xref, sc->len);
+                    sc->state = GED_SCAN_LINE;
+                } else if ((u < 0x80 || w == 1) && sc->len+1 < sizeof(sc->xref)) {
+                    sc->xref[sc->len++] = (char)u;
+                } else { // not an xref this index can hold
+                    sc->state = GED_SCAN_LINE;
+                }
+                break;
+            case GED_SCAN_LINE: break;
+        }
+        i += w;
+    }
+}
+
+int gedIndex_build(GedIndex *ix, FILE *in) {
+    DecodingFileReader r;
+    rewind(in);
+    int status = decodingFileReader_init(&r, in);
+    Codec format = r.format;
+    int64_t bom = r.bom;
+    decodingFileReader_destroy(&r);
+    if (status) return status;
+
+    memset(ix, 0, sizeof(GedIndex));
+    ix->format = format;
+    struct ged_index_scan sc = {0};
+    sc.state = GED_SCAN_START;
+    unsigned char *buf = malloc(GED_INDEX_BLOCK);
+    int64_t base = bom;
+    size_t got;
+    ged_index_seek(in, bom, SEEK_SET);
+    while ((got = fread(buf, 1, GED_INDEX_BLOCK, in)) > 0) {
+        ged_index_scan(ix, &sc, buf, got, base);
+        base += (int64_t)got;
+    }
+    free(buf);
+    ix->size = base;
+    ged_index_finish(ix);
+    return 0;
+}
+
+
+void gedIndex_save(const GedIndex *ix, FILE *to) {
+    fputs(GED_INDEX_MAGIC, to);
+    fprintf(to, "%" PRId64 " %d\n", ix->size, (int)ix->format);
+    for(size_t i=0; i<ix->count; i+=1) {
+        if (ix->records[i].xref) fprintf(to, "%" PRId64 " @%s@\n", ix->records[i].offset, ix->records[i].xref);
+        else fprintf(to, "%" PRId64 "\n", ix->records[i].offset);
+    }
+}
+
+int gedIndex_load(GedIndex *ix, FILE *from, FILE *in) {
+    char line[512];
+    int format;
+    memset(ix, 0, sizeof(GedIndex));
+    if (!fgets(line, sizeof(line), from) || strcmp(line, GED_INDEX_MAGIC)) return 1;
+    if (fscanf(from, "%" SCNd64 " %d", &ix->size, &format) != 2 || fgetc(from) != '\n') return 1;
+    if (ix->size != ged_index_size(in)) return 1;
+    ix->format = (Codec)format;
+    while (fgets(line, sizeof(line), from)) {
+        char *end;
+        int64_t offset = strtoll(line, &end, 10);
+        size_t n = strlen(end);
+        if (end == line || n == 0 || end[n-1] != '\n') {
+            gedIndex_free(ix);
+            return 1;
+        }
+        char *xref = 0;
+        if (n > 4 && end[0] == ' ' && end[1] == '@' && end[n-2] == '@')
+            xref = ged_index_strndup(end+2, n-4);
+        ged_index_add(ix, offset, xref);
+    }
+    ged_index_finish(ix);
+    return 0;
+}
+
+int gedIndex_open(GedIndex *ix, FILE *in, const char *sidecar) {
+    FILE *f = fopen(sidecar, "rb");
+    if (f) {
+        int bad = gedIndex_load(ix, f, in);
+        fclose(f);
+        if (!bad) return 0;
+    }
+    int status = gedIndex_build(ix, in);
+    if (status) return status;
+    f = fopen(sidecar, "wb");
+    if (f) {
+        gedIndex_save(ix, f);
+        if (fclose(f)) remove(sidecar);
+    }
+    return 0;
+}
+
+
+/// the index of the record `xref` (with or without @s), or ix->count if none
+static size_t ged_index_find(GedIndex *ix, const char *xref, size_t n) {
+    if (n >= 2 && xref[0] == '@' && xref[n-1] == '@') { xref += 1; n -= 2; }
+    char *key = ged_index_strndup(xref, n);
+    GedIndexRecord *r = trie_get(&ix->byxref, key);
+    free(key);
+    return r ? (size_t)(r - ix->records) : ix->count;
+}
+
+int gedIndex_has(const GedIndex *ix, const char *xref) {
+    return ged_index_find((GedIndex *)ix, xref, strlen(xref)) < ix->count;
+}
+
+/// marks with 2 each record in `want` that the `n` bytes at `p` point to
+static void ged_index_link(GedIndex *ix, const unsigned char *p, size_t n, char *want) {
+    int w = ged_index_width(ix->format);
+    char token[256];
+    size_t len = 0;
+    int open = 0;
+    for(size_t i=0; i+w<=n; i+=w) {
+        unsigned long u = ged_index_unit(p + i, ix->format);
+        if (u == '@') {
+            if (open && len < sizeof(token)) {
+                size_t j = ged_index_find(ix, token, len);
+                if (j < ix->count && !want[j]) want[j] = 2;
+            }
+            open = !open;
+            len = 0;
+        } else if (u == '\n' || u == '\r') {
+            open = 0;
+        } else if (open && len < sizeof(token)) {
+            if (u < 0x80 || w == 1) token[len++] = (char)u;
+            else len = sizeof(token); // not an xref this index holds
+        }
+    }
+}
+
+/**
+ * 1 if the `n` bytes at `p`, read from where record `i` of `ix` should
+ * be up to where the next should be, still look like that record: a
+ * level 0 (perhaps indented) with its xref, if it has one, ending with
+ * a line break.
+ */
+static int ged_index_fits(const GedIndex *ix, size_t i, const unsigned char *p, size_t n) {
+    int w = ged_index_width(ix->format);
+    const unsigned char *end = p + n;
+    while (p + w <= end && (ged_index_unit(p, ix->format) == ' ' || ged_index_unit(p, ix->format) == '\t')) p += w;
+    if (p + 2*w > end || ged_index_unit(p, ix->format) != '0') return 0;
+    p += w;
+    if (ged_index_unit(p, ix->format) != ' ' && ged_index_unit(p, ix->format) != '\t') return 0;
+    while (p + w <= end && (ged_index_unit(p, ix->format) == ' ' || ged_index_unit(p, ix->format) == '\t')) p += w;
+    const char *xref = ix->records[i].xref;
+    if (xref) {
+        if (p + w > end || ged_index_unit(p, ix->format) != '@') return 0;
+        for(p += w; *xref; xref += 1, p += w)
+            if (p + w > end || ged_index_unit(p, ix->format) != (unsigned char)*xref) return 0;
+        if (p + w > end || ged_index_unit(p, ix->format) != '@') return 0;
+    } else if (p + w <= end && ged_index_unit(p, ix->format) == '@') return 0;
+    if (i+1 < ix->count) {
+        unsigned long last = ged_index_unit(end - w, ix->format);
+        if (last != '\n' && last != '\r') return 0;
+    }
+    return 1;
+}
+
+static void ged_index_write(const char *bytes, size_t len, void *to) {
+    fwrite(bytes, 1, len, (FILE *)to);
+}
+
+int gedIndex_convert(const GedIndex *cix, FILE *in, const char *const *xrefs, size_t count, int linked, FILE *to, const GedOptions *options) {
+    GedIndex *ix = (GedIndex *)cix; // for trie_get, which changes nothing
+    if (!ix->count || ged_index_size(in) != ix->size) return 3;
+
+    char *want = calloc(ix->count, 1); // 1 if named, 2 if linked to
+    want[0] = 1; // HEAD
+    int missing = 0;
+    for(size_t i=0; i<count; i+=1) {
+        size_t j = ged_index_find(ix, xrefs[i], strlen(xrefs[i]));
+        if (j < ix->count) want[j] = 1;
+        else missing = 1;
+    }
+
+    // each record runs from its offset to the next one's; HEAD from the
+    // start of the file, to keep any byte order mark
+    unsigned char *text = 0;
+    size_t len = 0, cap = 0;
+    int stale = 0;
+    for(int round = linked ? 0 : 1; round < 2 && !missing && !stale; round += 1) {
+        for(size_t i=0; i<ix->count && !stale; i+=1) {
+            if (!want[i] || (round == 0 && want[i] != 1)) continue;
+            int64_t from = i ? ix->records[i].offset : 0;
+            int64_t upto = i+1 < ix->count ? ix->records[i+1].offset : ix->size;
+            if (upto <= ix->records[i].offset) { stale = 1; break; }
+            size_t n = (size_t)(upto - from);
+            if (len + n + 64 > cap) {
+                while (len + n + 64 > cap) cap = cap ? cap*2 : (1<<16);
+                text = realloc(text, cap);
+            }
+            size_t skip = (size_t)(ix->records[i].offset - from); // HEAD's byte order mark
+            if (ged_index_seek(in, from, SEEK_SET) || fread(text + len, 1, n, in) != n) stale = 1;
+            else if (!ged_index_fits(ix, i, text + len + skip, n - skip)) stale = 1;
+            else if (round == 0) ged_index_link(ix, text + len, n, want);
+            else len += n;
+        }
+    }
+    int status = stale ? 3 : 2;
+    if (!missing && !stale) {
+        len += ged_index_encode(text + len, "0 TRLR\n", ix->format);
+        status = ged551to700_memory(text, len, ged_index_write, to, options);
+    }
+    free(text);
+    free(want);
+    return status;
+}
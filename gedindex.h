@@ -0,0 +1,79 @@
+/**
+ * An index of where each record of a GEDCOM file starts, for converting
+ * a few records of a large file without reading all of it.
+ *
+ * GedIndex ix;
+ * gedIndex_open(&ix, in, "big.ged.idx"); // loads the index, or builds and saves it
+ * const char *want[] = {"I1", "@F2@"};   // @s are optional
+ * gedIndex_convert(&ix, in, want, 2, 1, out, 0);
+ * gedIndex_free(&ix);
+ *
+ * Building the index reads the file once, looking only at the first
+ * few bytes of each line, without decoding it. Converting reads just
+ * HEAD and the selected records, which are then converted like a file
+ * holding only them. Pointers to records that were not selected are
+ * left as they are.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+#pragma once
+
+#include <stdio.h>  // FILE
+#include <stddef.h> // size_t
+#include <stdint.h> // int64_t
+#include "ansel2utf8.h" // Codec
+#include "strtrie.h"
+#include "ged_ebp.h" // GedOptions
+
+typedef struct {
+    int64_t offset; // of the first byte of its level-0 line
+    char *xref;  // without the @s, or NULL if it has none
+} GedIndexRecord;
+
+typedef struct {
+    Codec format; // character encoding of the file
+    int64_t size; // of the file, to notice if it changed
+    GedIndexRecord *records; size_t count, cap; // in file order
+    trie byxref;  // xref to GedIndexRecord *
+} GedIndex;
+
+/**
+ * Fills `ix` by scanning `in`, which must be seekable. Returns 0, or
+ * nonzero if the encoding of `in` cannot be determined.
+ */
+int gedIndex_build(GedIndex *ix, FILE *in);
+
+/// writes `ix` to `to` in the form `gedIndex_load` reads
+void gedIndex_save(const GedIndex *ix, FILE *to);
+
+/**
+ * Fills `ix` from what `gedIndex_save` wrote to `from`. Returns 0, or
+ * nonzero if `from` is not an index or is for a file of a size other
+ * than `in`'s.
+ */
+int gedIndex_load(GedIndex *ix, FILE *from, FILE *in);
+
+/**
+ * Loads the index of `in` from the file named `sidecar` if that works;
+ * otherwise builds it and tries to save it there for next time.
+ * Returns 0, or nonzero as `gedIndex_build` does.
+ */
+int gedIndex_open(GedIndex *ix, FILE *in, const char *sidecar);
+
+/// 1 if `ix` has a record `xref` (with or without @s), 0 if not
+int gedIndex_has(const GedIndex *ix, const char *xref);
+
+/**
+ * Converts HEAD and the `count` records of `in` named by `xrefs` (and,
+ * if `linked` is nonzero, every record they point to) into `to`, in the
+ * order they appear in `in`. Returns 0; 1 if the records had a parse
+ * error; 2 if an xref is not in `ix`; or 3 if the index no longer fits
+ * `in` (its size differs, or a record to be read does not start with
+ * its level 0 line and xref where the index says). Nothing is converted
+ * in the last two cases.
+ */
+int gedIndex_convert(const GedIndex *ix, FILE *in, const char *const *xrefs, size_t count, int linked, FILE *to, const GedOptions *options);
+
+/// frees what `ix` holds (but not `ix`)
+void gedIndex_free(GedIndex *ix);
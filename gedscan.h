@@ -0,0 +1,101 @@
+/**
+ * Byte scanners for the innermost loops of decoding and parsing,
+ * looking at 16 (SSE2) or 32 (AVX2) bytes at a time where the compiler
+ * targets those instruction sets and one at a time elsewhere.
+ *
+ * size_t i = gedScan_ascii(p, n);          // p[i] is the first byte >= 0x80
+ * size_t j = gedScan_delim(p, n, "\n\r");  // p[j] is the first '\n' or '\r'
+ *
+ * Both return `n` if there is no such byte.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+#pragma once
+
+#include <stddef.h> // size_t
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GED_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#define GED_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanForward
+static inline int gedScan_ctz(unsigned mask) {
+    unsigned long ans;
+    _BitScanForward(&ans, mask);
+    return (int)ans;
+}
+#else
+/// index of the lowest set bit of `mask`, which must not be 0
+static inline int gedScan_ctz(unsigned mask) { return __builtin_ctz(mask); }
+#endif
+
+
+/// the length of the prefix of p[0..n) that is all ASCII (bytes < 0x80)
+static inline size_t gedScan_ascii(const unsigned char *p, size_t n) {
+    size_t i = 0;
+#ifdef GED_HAVE_AVX2
+    for(; i+32 <= n; i += 32) {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(p+i)));
+        if (mask) return i + gedScan_ctz(mask);
+    }
+#endif
+#ifdef GED_HAVE_SSE2
+    for(; i+16 <= n; i += 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p+i)));
+        if (mask) return i + gedScan_ctz(mask);
+    }
+#endif
+    while (i < n && p[i] < 0x80) i += 1;
+    return i;
+}
+
+/**
+ * The index of the first byte of p[0..n) that is one of the (at most
+ * four) characters of `delims`.
+ */
+static inline size_t gedScan_delim(const char *p, size_t n, const char *delims) {
+    char d[4];
+    int k = 0;
+    for(; k < 4 && delims[k]; k += 1) d[k] = delims[k];
+    for(int j = k; j < 4; j += 1) d[j] = d[0]; // repeats are harmless
+    size_t i = 0;
+#ifdef GED_HAVE_AVX2
+    {
+        __m256i d0 = _mm256_set1_epi8(d[0]), d1 = _mm256_set1_epi8(d[1]);
+        __m256i d2 = _mm256_set1_epi8(d[2]), d3 = _mm256_set1_epi8(d[3]);
+        for(; i+32 <= n; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(p+i));
+            __m256i hit = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(x, d0), _mm256_cmpeq_epi8(x, d1)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(x, d2), _mm256_cmpeq_epi8(x, d3)));
+            unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+            if (mask) return i + gedScan_ctz(mask);
+        }
+    }
+#endif
+#ifdef GED_HAVE_SSE2
+    {
+        __m128i d0 = _mm_set1_epi8(d[0]), d1 = _mm_set1_epi8(d[1]);
+        __m128i d2 = _mm_set1_epi8(d[2]), d3 = _mm_set1_epi8(d[3]);
+        for(; i+16 <= n; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(p+i));
+            __m128i hit = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(x, d0), _mm_cmpeq_epi8(x, d1)),
+                _mm_or_si128(_mm_cmpeq_epi8(x, d2), _mm_cmpeq_epi8(x, d3)));
+            unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+            if (mask) return i + gedScan_ctz(mask);
+        }
+    }
+#endif
+    for(; i < n; i += 1)
+        if (p[i] == d[0] || p[i] == d[1] || p[i] == d[2] || p[i] == d[3])
+            return i;
+    return n;
+}
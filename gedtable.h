@@ -0,0 +1,48 @@
+/**
+ * Constant look-up tables: arrays of key:value pairs, sorted by key,
+ * written out in the source so they cost nothing to set up and can be
+ * shared by any number of conversions at once.
+ *
+ * static const GedTableEntry colors[] = { // sorted as `cmp` sorts
+ *     {"blue", "#00f"}, {"green", "#0f0"}, {"red", "#f00"},
+ * };
+ * const GedTableEntry *e = gedTable_find(colors, GED_TABLE_SIZE(colors), "red", strcmp);
+ * // e->val is "#f00"; e would be NULL for a key not in the table
+ *
+ * Lookups bisect the table, so cost about log2(n) comparisons.
+ * `gedTable_sorted` is meant for asserts that catch edits that broke
+ * the order.
+ *
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+#pragma once
+
+#include <stddef.h> // size_t
+
+typedef struct {
+    const char *key;
+    const char *val;
+} GedTableEntry;
+
+#define GED_TABLE_SIZE(t) (sizeof(t)/sizeof((t)[0]))
+
+/// the entry of `t[0..n)` whose key `cmp` finds equal to `key`, or NULL
+static inline const GedTableEntry *gedTable_find(const GedTableEntry *t, size_t n, const char *key, int (*cmp)(const char *, const char *)) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi-lo)/2;
+        int c = cmp(key, t[mid].key);
+        if (!c) return t + mid;
+        if (c < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return 0;
+}
+
+/// 1 if the keys of `t[0..n)` are in strictly increasing order by `cmp`
+static inline int gedTable_sorted(const GedTableEntry *t, size_t n, int (*cmp)(const char *, const char *)) {
+    for(size_t i=1; i<n; i+=1)
+        if (cmp(t[i-1].key, t[i].key) >= 0) return 0;
+    return 1;
+}
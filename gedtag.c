@@ -0,0 +1,134 @@
+/**
+ * Implementation of the tag interning declared in gedtag.h
+ * 
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+
+#include <stdlib.h> // malloc, free
+#include <string.h> // strcmp, strdup
+#include <stdint.h> // uint32_t, intptr_t
+#include <assert.h>
+#include "gedtag.h"
+#include "strtrie.h"
+
+static const char *const gedTag_names[] = {
+    0,
+#define GED_TAG_NAME(t) #t,
+    GED_TAG_LIST(GED_TAG_NAME)
+#undef GED_TAG_NAME
+};
+
+/// FNV-1a with a seed, followed by a shift to mix the high bits down
+static uint32_t gedTag_hash(const char *s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for(; *s; s+=1) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+/**
+ * A two-level perfect hash ("hash and displace"): `gedTag_hash(s, 0)`
+ * picks one of 128 buckets, and that bucket's displacement `d` is the
+ * seed for `gedTag_hash(s, d)`, which picks one of 512 slots. The
+ * displacements were found greedily, largest bucket first, by trying
+ * d = 1, 2, ... until the bucket's tags landed only on empty slots.
+ */
+static const unsigned char gedTag_displace[128] = {
+      1,   0,   3,   1,   2,   2,   1,   0,   1,   1,   0,   3,   1,   1,   2,   2,
+      0,   0,   1,   0,   1,   0,   1,   1,   1,   1,   1,   1,   1,   2,   1,   1,
+      0,   1,   4,   0,   1,   1,   2,   1,   1,   0,   1,   1,   2,   1,   1,   2,
+      1,   0,   2,   1,   0,   1,   0,   1,   0,   0,   1,   1,   3,   1,   1,   1,
+      1,   3,   1,   0,   3,   1,   1,   2,   0,   0,   1,   1,   1,   1,   1,   1,
+      1,   0,   1,   1,   1,   1,   0,   1,   1,   3,   1,   1,   2,   3,   0,   1,
+      1,   0,   0,   2,   1,   3,   1,   1,   1,   1,   1,   2,   0,   1,   4,   3,
+      0,   1,   0,   1,   2,   0,   0,   2,   1,   1,   3,   0,   4,   2,   3,   1,
+};
+static const unsigned char gedTag_slots[512] = {
+      0,   0,   0,   0,  16,   0,  27, 106,   0,   0,  29, 122,   0,   0,   0,  46,
+      0,   0,   0,   0,   0,  43,   0,   0,   0, 158,   0,  89,   0,   0,   0,  26,
+      0,   0,   0,   0,   0,   0,   0, 169, 159,   0,   0,  47,   0,   0,   0,   0,
+    116,   0,   0,   0,  11,   0,   0, 136, 126,   0,   0,  78,   0,   0, 124,   0,
+     12,  45,   0,  81,   0,   0,  82,   0,   0,   0,   0,   0, 129,   0,   0,  52,
+    134, 149,   0,  99,   0,  38,  21,   0,   0,   0,  58,   0,   0,  28,  61,   0,
+      0,   0,   0,   0,   0,   0,  54,   0,   0,  50,   0,   0,   0,  75,   9,  80,
+      0,   0,   0, 146, 125,   0,  91,  31,  93,  72,   0,   0,   0,   0, 133,  39,
+     23, 154, 167, 138,  73,   0,  88,   0,   0, 111,   0,   0,   0,  44, 132,   0,
+    162,   0,   5,   0,  37,   0,   0,   0,   0,  48,   0,   0,   0,   1,   0,   0,
+      0,   0,   0,   7, 151,   0, 127,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,  13,   0,   0,   0,   0,   0,   0,   0,  17,   0, 163, 123,   0,
+      0,   0,   0,   0,   0,   0,   0, 144,   0,   0, 120, 150,   0,  59,   0,   0,
+      0, 147, 153,  86,  55,   0, 156,  63,   0,   0,   0,  62,   0,  60,   0,   0,
+      0,  90,   0,   0,   0,   0,   0,   0,   0, 142,   0,   0,   0,   0,  70,   0,
+      0, 113,   0,   0,   0,   0, 121,   0,   0,   2,  35,   0,  56,   0,  25,  32,
+      0, 152,   0, 101,  77,   0,   0,  65,   0,   0,  53,   0,   0,   0, 157,   0,
+     15,   0,   0, 141,   3,  67, 114,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0, 119, 100,   0,   0,   0,  64,   0,   0,  97,
+    110,  87,   0,   0,   0,   0,   0,   0,   0,   0, 130,  14,   0,   0,   0,   0,
+     24,   0, 155,   0, 108,   0, 102, 145,   0,   0,   0,   0, 139,  79,   0, 168,
+    131,  18,   0,   0,   0,   0,   0,   0,   0,  42,   0,   0, 128,   0,   0,  76,
+      0,   0,   0,   0,  40, 148,   0,   0,   0,   0,   0,   0, 115,   0,   0,   0,
+      0, 107,   0,   0,   0,   0,  57,   0,   0, 135,   0,   0,   0,   0, 161,   0,
+     98,   0,   0,  33,   0,   0,  69, 140,   0,  36,   0,   0,   0,   0,   0,   0,
+      0,   0,   0, 160,   0,  85,   0,   0,   0,   0,  95,   0,   0,   0, 112,   0,
+      0,   0,   0,   0,  66,   0,  10,   0,   0,   0,   0,   0,  71,   0, 164,   0,
+    105, 143,   0,   0,   0, 137,   0,   0,   0,   0,   0,   6,   0,   0,   0,   0,
+      0,   0,   0,   0,  68,   0,  96,   0,   0,   8,   0,   0,   0,   0, 118, 171,
+     94,   0, 104,   0,  41, 165,   0,   0,  92,   0, 170,   4, 103, 166,   0,   0,
+      0,   0,  84,   0,  74,   0, 109,   0,   0,   0,   0,   0,   0,  51,  30, 117,
+      0,   0,   0,  83,   0,  22,  34,  19,  20,  49,   0,   0,   0,   0,   0,   0,
+};
+
+int gedTag_lookup(const char *tag) {
+    uint32_t d = gedTag_displace[gedTag_hash(tag, 0) & 127];
+    int id = gedTag_slots[gedTag_hash(tag, d) & 511];
+    if (id && !strcmp(gedTag_names[id], tag)) return id;
+    return GED_TAG_EXTENSION;
+}
+
+const char *gedTag_name(int id) {
+    if (id > GED_TAG_NONE && id < GED_TAG_EXTENSION) return gedTag_names[id];
+    return 0;
+}
+
+
+struct gedTagTable_t {
+    trie ids; // extension tag → ID
+};
+
+GedTagTable *gedTagTable_create() {
+#ifndef NDEBUG
+    // catch GED_TAG_LIST edits that were not followed by new tables
+    for(int i=GED_TAG_NONE+1; i<GED_TAG_EXTENSION; i+=1)
+        assert(gedTag_lookup(gedTag_names[i]) == i);
+#endif
+    return calloc(1, sizeof(GedTagTable));
+}
+
+void gedTagTable_free(GedTagTable *t) {
+    for(size_t i=0; i<t->ids.length; i+=1)
+        free(t->ids.kvpairs[2*i]);
+    trie_free(&t->ids);
+    free(t);
+}
+
+int gedTagTable_intern(GedTagTable *t, const char *tag, const char **name) {
+    if (!*tag) return GED_TAG_NONE;
+    for(const char *c = tag; *c; c+=1)
+        if (!((*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '_'))
+            return GED_TAG_NONE;
+    
+    int id = gedTag_lookup(tag);
+    if (id != GED_TAG_EXTENSION) {
+        *name = gedTag_names[id];
+        return id;
+    }
+    
+    intptr_t known = (intptr_t)trie_get(&t->ids, tag);
+    if (!known) {
+        known = GED_TAG_EXTENSION + 1 + t->ids.length;
+        trie_put(&t->ids, strdup(tag), (void *)known);
+    }
+    // kvpairs is in insertion order, so the key is at a known index
+    *name = t->ids.kvpairs[2*(known - GED_TAG_EXTENSION - 1)];
+    return known;
+}
@@ -0,0 +1,76 @@
+/**
+ * Interned GEDCOM tags.
+ * 
+ * Every standard 5.5.1 and 7.0 tag, plus the extension tags that some
+ * filter looks for, has a fixed small integer ID `GED_TAG_<tag>` (e.g.
+ * `GED_TAG_NAME`, `GED_TAG__UID` for `_UID`). Those are found with a
+ * perfect hash, so identifying a tag costs one hash and one `strcmp`.
+ * 
+ * Any other tag is given an ID above `GED_TAG_EXTENSION` by the
+ * `GedTagTable` of the input it was read from; such IDs are only
+ * meaningful within that one conversion.
+ * 
+ * Written for this project by its contributors and released into the
+ * public domain under the Unlicense; see LICENSE.
+ */
+#pragma once
+
+/**
+ * The known tags, in ID order. Changing this list requires recomputing
+ * `gedTag_slots` and `gedTag_displace` in gedtag.c.
+ */
+#define GED_TAG_LIST(X) \
+    X(ABBR) X(ADDR) X(ADOP) X(ADR1) X(ADR2) X(ADR3) X(AFN) X(AGE) X(AGNC) \
+    X(ALIA) X(ANCE) X(ANCI) X(ANUL) X(ASSO) X(AUTH) X(BAPL) X(BAPM) X(BARM) \
+    X(BASM) X(BIRT) X(BLES) X(BLOB) X(BURI) X(CALN) X(CAST) X(CAUS) X(CENS) \
+    X(CHAN) X(CHAR) X(CHIL) X(CHR) X(CHRA) X(CITY) X(CONC) X(CONF) X(CONL) \
+    X(CONT) X(COPR) X(CORP) X(CREA) X(CREM) X(CROP) X(CTRY) X(DATA) X(DATE) \
+    X(DEAT) X(DESC) X(DESI) X(DEST) X(DIV) X(DIVF) X(DSCR) X(EDUC) X(EMAI) \
+    X(EMAIL) X(EMIG) X(ENDL) X(ENGA) X(EVEN) X(EXID) X(FACT) X(FAM) X(FAMC) \
+    X(FAMF) X(FAMS) X(FAX) X(FCOM) X(FILE) X(FONE) X(FORM) X(GEDC) X(GIVN) \
+    X(GRAD) X(HEAD) X(HEIGHT) X(HUSB) X(IDNO) X(IMMI) X(INDI) X(INIL) \
+    X(LANG) X(LATI) X(LEFT) X(LEGA) X(LONG) X(MAP) X(MARB) X(MARC) X(MARL) \
+    X(MARR) X(MARS) X(MEDI) X(MIME) X(NAME) X(NATI) X(NATU) X(NCHI) X(NICK) \
+    X(NMR) X(NO) X(NOTE) X(NPFX) X(NSFX) X(OBJE) X(OCCU) X(ORDI) X(ORDN) \
+    X(PAGE) X(PEDI) X(PHON) X(PHRASE) X(PLAC) X(POST) X(PROB) X(PROP) \
+    X(PUBL) X(QUAY) X(REFN) X(RELA) X(RELI) X(REPO) X(RESI) X(RESN) X(RETI) \
+    X(RFN) X(RIN) X(ROLE) X(ROMN) X(SCHMA) X(SDATE) X(SEX) X(SLGC) X(SLGS) \
+    X(SNOTE) X(SOUR) X(SPFX) X(SSN) X(STAE) X(STAT) X(SUBM) X(SUBN) X(SURN) \
+    X(TAG) X(TEMP) X(TEXT) X(TIME) X(TITL) X(TOP) X(TRAN) X(TRLR) X(TYPE) \
+    X(UID) X(VERS) X(WIDTH) X(WIFE) X(WILL) X(WWW) X(FSFTID) X(_APID) \
+    X(_ASSO) X(_CRE) X(_CREAT) X(_DATE) X(_EMAIL) X(_FID) X(_FSFTID) \
+    X(_INIT) X(_RUFNAM) X(_RUFNAME) X(_SDATE) X(_UID)
+
+typedef enum {
+    GED_TAG_NONE = 0, // not yet looked up
+#define GED_TAG_ENUM(t) GED_TAG_##t,
+    GED_TAG_LIST(GED_TAG_ENUM)
+#undef GED_TAG_ENUM
+    GED_TAG_EXTENSION, // a tag not in GED_TAG_LIST; see GedTagTable
+} GedTag;
+
+/// the known tag with the given spelling, or GED_TAG_EXTENSION if none
+int gedTag_lookup(const char *tag);
+
+/// the spelling of a known tag, or NULL if `id` is not a known tag
+const char *gedTag_name(int id);
+
+
+typedef struct gedTagTable_t GedTagTable;
+
+/// creates an empty table of extension tags
+GedTagTable *gedTagTable_create();
+
+/// frees the table, including all strings it has returned
+void gedTagTable_free(GedTagTable *t);
+
+/**
+ * Finds the ID of `tag` and, in `*name`, a copy of `tag` that lives as
+ * long as the table. Extension tags are given new IDs the first time
+ * they are seen.
+ * 
+ * Only tags spelled entirely with `A-Z`, `0-9`, and `_` are interned;
+ * for anything else (including the empty string) returns GED_TAG_NONE
+ * and leaves `*name` unchanged.
+ */
+int gedTagTable_intern(GedTagTable *t, const char *tag, const char **name);
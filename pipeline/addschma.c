@@ -14,7 +14,7 @@
  * Should happen after `ged_tagcase` to reliably identify tags.
  * 
  * FIX ME: right now just contains some placeholder URIs. Add correct
- * URIs to ged_addschma_maker as those are determined. Or possibly have
+ * URIs to ged_addschma_known as those are determined. Or possibly have
  * the ged_addschma_maker refer to some kind of config file (maybe just
  * a gedcom with a reference schema?)
  */
@@ -31,6 +31,8 @@
 #include <ctype.h>
 
 #include "../strtrie.h"
+#include "../gedtable.h"
+#include <assert.h>
 
 #ifdef _MSC_VER
 // The MSVC compiler does not provide strndup support.
@@ -52,8 +54,19 @@ enum ged_addschma_flags {
     GED_ADDSCHMA_NEED_SCHMA = 16,
 };
 
+/// extension tags with known URIs, sorted by tag
+static const GedTableEntry ged_addschma_known[] = {
+    {"_AIDN", "http://genealogy.net/GEDCOM#_AIDN"},
+    {"_DMGD", "http://genealogy.net/GEDCOM#_DMGD"},
+    {"_GOV", "http://genealogy.net/GEDCOM#_GOV"},
+    {"_GOVTYPE", "http://genealogy.net/GEDCOM#_GOVTYPE"},
+    {"_LOC", "http://genealogy.net/GEDCOM#_LOC"},
+    {"_MAIDENHEAD", "http://genealogy.net/GEDCOM#_MAIDENHEAD"},
+    {"_POST", "http://genealogy.net/GEDCOM#_POST"},
+    // ...
+};
+
 struct ged_addschma_memory {
-    trie known; // constant look-up
     trie decl;  // pass 1 fills with the HEAD.SCHMA, if present
     trie used;  // pass 1 fills with set of _EXTTAG in use
     int level;
@@ -66,11 +79,11 @@ void ged_addschma1(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     if (event->type == GED_START) {
         state->level += 1;
 
-        if (state->level == 0 && !strcmp("HEAD",event->data)) {
+        if (state->level == 0 && ged_tag(event) == GED_TAG_HEAD) {
             state->flags |= GED_ADDSCHMA_IN_HEAD;
-        } else if (state->level == 1 && (state->flags & GED_ADDSCHMA_IN_HEAD) && !strcmp("SCHMA",event->data)) {
+        } else if (state->level == 1 && (state->flags & GED_ADDSCHMA_IN_HEAD) && ged_tag(event) == GED_TAG_SCHMA) {
             state->flags |= GED_ADDSCHMA_IN_SCHMA;
-        } else if (state->level == 2 && (state->flags & GED_ADDSCHMA_IN_SCHMA) && !strcmp("TAG",event->data)) {
+        } else if (state->level == 2 && (state->flags & GED_ADDSCHMA_IN_SCHMA) && ged_tag(event) == GED_TAG_TAG) {
             state->flags |= GED_ADDSCHMA_IN_TAG;
         }
         
@@ -104,13 +117,15 @@ void ged_addschma2(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     
     if (!(state->flags & GED_ADDSCHMA_PASS2)) {
         int need = 0;
-        for(size_t i=0; i<2*state->used.length; i+=2)
-            if (!trie_get(&state->decl, state->used.kvpairs[i])
-            && trie_get(&state->known, state->used.kvpairs[i])) {
+        for(size_t i=0; i<2*state->used.length; i+=2) {
+            if (trie_get(&state->decl, state->used.kvpairs[i])) continue;
+            const GedTableEntry *known = gedTable_find(ged_addschma_known,
+                GED_TABLE_SIZE(ged_addschma_known), state->used.kvpairs[i], strcmp);
+            if (known) {
                 need = 1;
-                trie_put(&state->used, state->used.kvpairs[i], 
-                    trie_get(&state->known, state->used.kvpairs[i]));
+                trie_put(&state->used, state->used.kvpairs[i], (void *)known->val);
             }
+        }
         state->flags |= GED_ADDSCHMA_PASS2;
         if (need) state->flags |= GED_ADDSCHMA_NEED_SCHMA;
     }
@@ -118,9 +133,9 @@ void ged_addschma2(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     if (event->type == GED_START) {
         state->level += 1;
 
-        if (state->level == 0 && !strcmp("HEAD",event->data)) {
+        if (state->level == 0 && ged_tag(event) == GED_TAG_HEAD) {
             state->flags |= GED_ADDSCHMA_IN_HEAD;
-        } else if (state->level == 1 && (state->flags & GED_ADDSCHMA_IN_HEAD) && !strcmp("SCHMA",event->data)) {
+        } else if (state->level == 1 && (state->flags & GED_ADDSCHMA_IN_HEAD) && ged_tag(event) == GED_TAG_SCHMA) {
             state->flags |= GED_ADDSCHMA_IN_SCHMA;
             state->flags &= ~GED_ADDSCHMA_NEED_SCHMA;
         }
@@ -129,7 +144,7 @@ void ged_addschma2(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
             state->flags &= ~GED_ADDSCHMA_IN_HEAD;
             
             if (state->flags & GED_ADDSCHMA_NEED_SCHMA) {
-                GedEvent tmp;
+                GedEvent tmp = {0};
 
                 tmp.type = GED_START;
                 tmp.data = "SCHMA";
@@ -166,7 +181,7 @@ void ged_addschma2(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
 
             for(size_t i=0; i<2*state->used.length; i+=2)
                 if (state->used.kvpairs[i+1]) {
-                    GedEvent tmp;
+                    GedEvent tmp = {0};
                     
                     tmp.type = GED_START;
                     tmp.data = "TAG";
@@ -193,29 +208,66 @@ void ged_addschma2(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
 }
 
 
+/**
+ * Saves `decl` and `used` as pass 1 left them: a line with the number
+ * of each, then for each declaration a line with the lengths of its
+ * tag and URI followed by both, then for each used tag a line with its
+ * length followed by it.
+ */
+void ged_addschma_save(const void *rawstate, FILE *to) {
+    const struct ged_addschma_memory *state = (const struct ged_addschma_memory *)rawstate;
+    fprintf(to, "%zu %zu\n", state->decl.length, state->used.length);
+    for(size_t i=0; i<2*state->decl.length; i+=2) {
+        const char *tag = state->decl.kvpairs[i], *uri = state->decl.kvpairs[i+1];
+        fprintf(to, "%zu %zu\n%s%s\n", strlen(tag), strlen(uri), tag, uri);
+    }
+    for(size_t i=0; i<2*state->used.length; i+=2) {
+        const char *tag = state->used.kvpairs[i];
+        fprintf(to, "%zu\n%s\n", strlen(tag), tag);
+    }
+}
+
+/// reads `len` bytes and a newline from `from` into a new string, or returns NULL
+static char *ged_addschma_read(FILE *from, size_t len) {
+    char *ans = malloc(len+1);
+    if (fread(ans, 1, len, from) != len) { free(ans); return 0; }
+    ans[len] = 0;
+    return ans;
+}
+
+/// loads what `ged_addschma_save` wrote, as if pass 1 had run
+int ged_addschma_load(void *rawstate, FILE *from) {
+    struct ged_addschma_memory *state = (struct ged_addschma_memory *)rawstate;
+    size_t decls, useds, n, m;
+    if (fscanf(from, "%zu %zu", &decls, &useds) != 2 || fgetc(from) != '\n') return 1;
+    for(size_t i=0; i<decls; i+=1) {
+        if (fscanf(from, "%zu %zu", &n, &m) != 2 || fgetc(from) != '\n') return 1;
+        char *tag = ged_addschma_read(from, n);
+        char *uri = tag ? ged_addschma_read(from, m) : 0;
+        if (!uri || fgetc(from) != '\n') { free(tag); free(uri); return 1; }
+        const char *old = trie_put(&state->decl, tag, uri);
+        if (old) free((void *)old);
+    }
+    for(size_t i=0; i<useds; i+=1) {
+        if (fscanf(from, "%zu", &n) != 1 || fgetc(from) != '\n') return 1;
+        char *tag = ged_addschma_read(from, n);
+        if (!tag || fgetc(from) != '\n') { free(tag); return 1; }
+        if (!trie_get(&state->used, tag)) trie_put(&state->used, tag, 0);
+        else free(tag);
+    }
+    return 0;
+}
+
 void *ged_addschma_maker() { 
+    assert(gedTable_sorted(ged_addschma_known, GED_TABLE_SIZE(ged_addschma_known), strcmp));
     struct ged_addschma_memory *ans = calloc(1, sizeof(struct ged_addschma_memory));
-    
     ans->level = -1;
-    
-    trie_put(&ans->known, "_LOC", "http://genealogy.net/GEDCOM#_LOC");
-    trie_put(&ans->known, "_GOVTYPE", "http://genealogy.net/GEDCOM#_GOVTYPE");
-    trie_put(&ans->known, "_POST", "http://genealogy.net/GEDCOM#_POST");
-    trie_put(&ans->known, "_GOV", "http://genealogy.net/GEDCOM#_GOV");
-    trie_put(&ans->known, "_MAIDENHEAD", "http://genealogy.net/GEDCOM#_MAIDENHEAD");
-    trie_put(&ans->known, "_DMGD", "http://genealogy.net/GEDCOM#_DMGD");
-    trie_put(&ans->known, "_AIDN", "http://genealogy.net/GEDCOM#_AIDN");
-    // ...
-    
     return ans;
 }
 
 void ged_addschma_freer(void *rawstate) { 
     struct ged_addschma_memory *state = (struct ged_addschma_memory *)rawstate;
     
-    // known: all string literals, so don't free kvpairs
-    trie_free(&state->known);
-    
     // decl: all from input, so do free kv pair
     for(size_t i=0; i<2*state->decl.length; i+=1)
         free((void *)state->decl.kvpairs[i]);
@@ -20,10 +20,10 @@
 void ged_agefix(GedEvent *event, GedEmitterTemplate *emitter, void *state) {
     long *isAGE = (long *)state;
     if (event->type == GED_START)
-        *isAGE = !strcmp("AGE", event->data);
+        *isAGE = ged_tag(event) == GED_TAG_AGE;
     if (*isAGE && event->type == GED_TEXT) {
         GedAge *parsed = gedAgeParse551(event->data);
-        GedEvent evt;
+        GedEvent evt = {0};
         evt.type = GED_TEXT;
         evt.data = gedAgePayload(parsed);
         evt.flags = GED_OWNS_DATA;
@@ -36,7 +36,7 @@ void ged_agefix(GedEvent *event, GedEmitterTemplate *emitter, void *state) {
             
             evt.type = GED_TEXT;
             evt.data = parsed->phrase;
-            evt.flags = GED_OWNS_DATA;
+            evt.flags = event->flags & GED_OWNS_DATA; // phrase is the payload
             emitter->emit(emitter, evt);
             
             evt.type = GED_END;
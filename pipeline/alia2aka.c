@@ -6,7 +6,7 @@
  */
 
 struct ged_alia2aka_state {
-    char level;
+    int level;
     char inIndi;
     char inIndiAlia;
 };
@@ -22,8 +22,8 @@ void ged_alia2aka(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     if (event->type == GED_START) {
         state->level += 1;
         if (state->level == 1)
-            state->inIndi = !strcmp("INDI", event->data);
-        state->inIndiAlia = state->inIndi && state->level == 2 && !strcmp("ALIA", event->data);
+            state->inIndi = ged_tag(event) == GED_TAG_INDI;
+        state->inIndiAlia = state->inIndi && state->level == 2 && ged_tag(event) == GED_TAG_ALIA;
         if (state->inIndiAlia) { // don't emit this tag yet, might change
             ged_destroy_event(event);
             return; 
@@ -50,3 +50,7 @@ void ged_alia2aka(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     }
     emitter->emit(emitter, *event);
 }
+
+void *ged_alia2akastate_maker() { 
+    return calloc(1, sizeof(struct ged_alia2aka_state));
+}
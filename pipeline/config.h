@@ -17,8 +17,32 @@
  *    substructure you should note the adding goal when you get the
  *    GED_START but not actually add it until the next GED_END or 
  *    GED_START.
+ *    Identify tags with `ged_tag(event) == GED_TAG_...` (see gedtag.h)
+ *    and rename them with `changeTagTo`, not with `strcmp`.
+ *    Read settings from `emitter->options`; keep no globals.
  * 4. #include your .c file below
- * 5. add your entry into the pipeline
+ * 5. add your entry, named for reports, into the pipeline; set
+ *    `ordered` if its state carries anything from one record to the next
+ * 
+ * With more than one thread (`GedOptions.threads`), pass 2 runs on runs of
+ * whole records at once, each on a separate copy of the states of the
+ * filters without `ordered`. The `ordered` filters run afterwards on a
+ * single state, in file order and in pipeline order, so each must give
+ * the same result if moved after all the unordered filters below it.
+ * 
+ * An entry whose first pass leaves anything in its state for its second
+ * pass must also have a saver and loader for that, which
+ * `GedOptions.cache_dir` uses to skip the first pass entirely, and which
+ * also copies it into each thread's states if the entry is not `ordered`.
+ * 
+ * Input that cannot be rewound (or `GedOptions.streaming`) is read once.
+ * An entry with a different function for each pass then runs its
+ * first-pass function in place of its second-pass one over the whole
+ * input, and its second-pass function afterwards over the first record
+ * alone. So its second pass may only change the first record (HEAD),
+ * and it must come before every filter that has no first pass. An entry
+ * with the same function for both passes (like `exid`, whose first pass
+ * only learns HEAD.SOUR, which no filter before it changes) is exempt.
  */
 
 #include "nop.c" // ged_nostate_maker, ged_nostate_freer
@@ -53,49 +77,52 @@
 #endif
 
 struct {
+    const char *name; // for reports such as `GedOptions.profile`
     GedFilterFunc passes[2];
     GedFilterStateMaker maker;
     GedFilterStateFreer freer;
-    int twopass;
+    int ordered; // must see every record of the file with one state
+    GedFilterStateSaver save; // what pass 1 left for pass 2, if anything
+    GedFilterStateLoader load;
 } ged_pipeline[] = {
     // turn CONC into GED_TEXT and CONT into GED_LINEBREAK
-    {{ged_unconc, ged_unconc}, ged_longstate_maker, ged_longstate_freer},
+    {"unconc", {ged_unconc, ged_unconc}, ged_longstate_maker, ged_longstate_freer},
     
     // merge adjacent GED_TEXT and GED_LINEBREAK into single GED_TEXT
-    {{ged_merge, ged_merge}, ged_mergestate_maker, ged_mergestate_freer},
+    {"mergepayload", {ged_merge, ged_merge}, ged_mergestate_maker, ged_mergestate_freer},
 
     // capitalize tags; GED_ERROR if illegal characters used in tag
-    {{ged_tagcase, ged_tagcase}, ged_nostate_maker, ged_nostate_freer},
+    {"tagcase", {ged_tagcase, ged_tagcase}, ged_nostate_maker, ged_nostate_freer},
+
+    // two-pass handling of SCHMA
+    {"addschma", {ged_addschma1, ged_addschma2}, ged_addschma_maker, ged_addschma_freer, 1, ged_addschma_save, ged_addschma_load},
 
     // various simple tag renames
-    {{0, ged_rename}, ged_longstate_maker, ged_longstate_freer},
+    {"rename", {0, ged_rename}, ged_renamestate_maker, ged_longstate_freer},
     // remove obsolete tags
-    {{0, ged_discard}, ged_longstate_maker, ged_longstate_freer},
-
-    // two-pass handling of SCHMA
-    {{ged_addschma1, ged_addschma2}, ged_addschma_maker, ged_addschma_freer},
+    {"discard", {0, ged_discard}, ged_discardstate_maker, ged_longstate_freer},
 
     // change "English" to "en", etc
-    {{0, ged_langtag}, ged_langtagstate_maker, ged_langtagstate_freer},
+    {"langtag", {0, ged_langtag}, ged_langtagstate_maker, ged_langtagstate_freer},
     // Update to 7.0 DATE format
-    {{0, ged_datefix}, ged_longstate_maker, ged_longstate_freer},
+    {"datefix", {0, ged_datefix}, ged_longstate_maker, ged_longstate_freer},
     // Update to 7.0 AGE format
-    {{0, ged_agefix}, ged_longstate_maker, ged_longstate_freer},
+    {"agefix", {0, ged_agefix}, ged_longstate_maker, ged_longstate_freer},
     // Update to 7.0 OBJE.FILE.FORM format
-    {{0, ged_mediatype}, ged_longstate_maker, ged_longstate_freer},
+    {"mediatype", {0, ged_mediatype}, ged_longstate_maker, ged_longstate_freer},
     // Update FILE to have URL payload
-    {{0, ged_filenames}, ged_longstate_maker, ged_longstate_freer},
+    {"filenames", {0, ged_filenames}, ged_longstate_maker, ged_longstate_freer},
     // change ROMN and FONE to TRAN with appropriate LANG
-    {{0, ged_tran}, ged_longstate_maker, ged_longstate_freer},
+    {"tran", {0, ged_tran}, ged_transtate_maker, ged_longstate_freer},
     // change AFN, RIN, and RFN into EXID with appropriate TYPE
-    {{0, ged_exid}, ged_exidstate_maker, ged_exidstate_freer},
+    {"exid", {ged_exid, ged_exid}, ged_exidstate_maker, ged_exidstate_freer, 0, ged_exid_save, ged_exid_load},
     // change RELA to ROLE with PHRASE
-    {{0, ged_rela2role}, ged_longstate_maker, ged_longstate_freer},
+    {"rela2role", {0, ged_rela2role}, ged_longstate_maker, ged_longstate_freer},
     // change RELA to ROLE with PHRASE
-    {{0, ged_note2snote}, ged_longstate_maker, ged_longstate_freer},
+    {"note2snote", {0, ged_note2snote}, ged_note2snotestate_maker, ged_longstate_freer},
 
     // not technically 5→7, this is to fix a common misuse of ALIA
-    {{0, ged_alia2aka}, ged_longstate_maker, ged_longstate_freer},
+    {"alia2aka", {0, ged_alia2aka}, ged_alia2akastate_maker, ged_longstate_freer},
 
     //// pass 1 assemble parse events into records
     //{{ged_event2record,0}, ged_event2recordstate_maker, ged_event2recordstate_freer},
@@ -105,27 +132,26 @@ struct {
     //{{ged_record2event,0}, ged_nostate_maker, ged_nostate_freer},
 
     // pass 2 assemble parse events into records
-    {{0, ged_event2record}, ged_event2recordstate_maker, ged_event2recordstate_freer},
+    {"event2record", {0, ged_event2record}, ged_event2recordstate_maker, ged_event2recordstate_freer},
     // change non-pointer SOUR substructures into pointer to SOUR records
-    {{0, ged_sours2r}, ged_longstate_maker, ged_longstate_freer},
+    {"sours2r", {0, ged_sours2r}, ged_serialstate_maker, ged_longstate_freer},
     // change non-pointer OBJE substructures into pointer to OBJE records
-    {{0, ged_objes2r}, ged_longstate_maker, ged_longstate_freer},
+    {"objes2r", {0, ged_objes2r}, ged_serialstate_maker, ged_longstate_freer},
 #ifdef CHANGE_NAMES
     // convert to 7.0 NAME stucture
-    {{0, ged_names}, ged_nostate_maker, ged_nostate_freer},
+    {"names", {0, ged_names}, ged_nostate_maker, ged_nostate_freer},
 #endif
     // covert assembled records back into parse events
-    {{0, ged_record2event}, ged_nostate_maker, ged_nostate_freer},
+    {"record2event", {0, ged_record2event}, ged_nostate_maker, ged_nostate_freer},
 
     // Standardize enums
-    {{0, ged_enums}, ged_longstate_maker, ged_longstate_freer},
+    {"enums", {0, ged_enums}, ged_longstate_maker, ged_longstate_freer},
     // restrict anchors and pointers to allowed character set
-    {{0, ged_fixid}, ged_fixidstate_maker, ged_fixidstate_freer},
+    {"fixid", {0, ged_fixid}, ged_fixidstate_maker, ged_fixidstate_freer, 1},
     
     // fix version number
-    {{0, ged_version}, ged_longstate_maker, ged_longstate_freer},
+    {"version", {0, ged_version}, ged_versionstate_maker, ged_longstate_freer, 1},
 
-    // convert '\n' back to GED_LINEBREAK to prep for CONT encoding
-    {{0, ged_unmerge}, ged_nostate_maker, ged_nostate_freer}, // should be last
+    // payloads keep their '\n's; the sink writes them as CONT lines
 };
 //{ged_nop, ged_nostate_maker, ged_nostate_freer},
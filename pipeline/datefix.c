@@ -30,14 +30,16 @@
 void ged_datefix(GedEvent *event, GedEmitterTemplate *emitter, void *state) {
     long *isDATE = (long *)state;
     if (event->type == GED_START)
-        *isDATE = !strcmp("DATE", event->data) 
-            || !strcmp("SDATE", event->data)
-            || !strcmp("CHAN", event->data)
-            || !strcmp("CREA", event->data)
+        *isDATE = ged_tag(event) == GED_TAG_DATE 
+            || ged_tag(event) == GED_TAG_SDATE
+            || ged_tag(event) == GED_TAG_CHAN
+            || ged_tag(event) == GED_TAG_CREA
             ;
     if (*isDATE && event->type == GED_TEXT) {
-        GedDateValue *parsed = gedDateParse551(event->data);
-        GedEvent evt;
+        // the parser takes ownership of its argument
+        GedDateValue *parsed = gedDateParse551(
+            (event->flags & GED_OWNS_DATA) ? event->data : strdup(event->data));
+        GedEvent evt = {0};
         evt.type = GED_TEXT;
         evt.data = gedDatePayload(parsed);
         evt.flags = GED_OWNS_DATA;
@@ -7,8 +7,8 @@
  */
 
 struct ged_discard_state {
-    char level;
-    char cutLevel;
+    int level;
+    int cutLevel;
     char inHeadGedc; // 1 = HEAD, 2 = HEAD.GEDC
 };
 
@@ -20,14 +20,14 @@ void ged_discard(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
         state->level += 1;
         
         if (state->level == 1)
-            state->inHeadGedc = !strcmp("HEAD",event->data);
+            state->inHeadGedc = ged_tag(event) == GED_TAG_HEAD;
         if (state->level == 2 && state->inHeadGedc)
-            state->inHeadGedc = 1 + !strcmp("GEDC",event->data);
+            state->inHeadGedc = 1 + (ged_tag(event) == GED_TAG_GEDC);
         
         if (!state->cutLevel)
-            if (!strcmp("SUBN",event->data)
-            || (state->inHeadGedc == 1 && state->level == 2 && (!strcmp("CHAR",event->data) || !strcmp("FILE",event->data)))
-            || (state->inHeadGedc == 2 && state->level == 3 && !strcmp("FORM",event->data))
+            if (ged_tag(event) == GED_TAG_SUBN
+            || (state->inHeadGedc == 1 && state->level == 2 && (ged_tag(event) == GED_TAG_CHAR || ged_tag(event) == GED_TAG_FILE))
+            || (state->inHeadGedc == 2 && state->level == 3 && ged_tag(event) == GED_TAG_FORM)
             ){ 
                 state->cutLevel = state->level;
             }
@@ -47,3 +47,6 @@ void ged_discard(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
         ged_destroy_event(event);
 }
 
+void *ged_discardstate_maker() { 
+    return calloc(1, sizeof(struct ged_discard_state));
+}
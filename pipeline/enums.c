@@ -1,4 +1,5 @@
 #include <string.h>
+#include "../gedtable.h"
 
 /**
  * Looks for known enumerated-set tags in 5.5.1 and converst to 7.0 by
@@ -7,8 +8,7 @@
  * - moving user-defined text into a PHRASE
  * 
  * This code is hard to read because I decided to try to use an existing
- * state instead of fully tracking context and used a lot of strcasecmp
- * instead of making any kind of lookup, but it seems to work OK.
+ * state instead of fully tracking context, but it seems to work OK.
  */
 
 /*
@@ -52,6 +52,60 @@ enum {
     GED_ENUM_NAME, GED_ENUM_NAME_TYPE,
     GED_ENUM_TEMPLE,
 };
+/**
+ * The known payloads of each enumerated type, sorted the way
+ * `strcasecmp` sorts them. Only GED_ENUM_OTHER, GED_ENUM_FAMC, and
+ * GED_ENUM_NAME have none.
+ */
+static const GedTableEntry ged_enum_famc_adop[] = {
+    {"BOTH"}, {"HUSB"}, {"OTHER"}, {"WIFE"},
+};
+static const GedTableEntry ged_enum_famc_stat[] = {
+    {"CHALLENGED"}, {"DISPROVEN"}, {"OTHER"}, {"PROVEN"},
+};
+static const GedTableEntry ged_enum_medi[] = {
+    {"AUDIO"}, {"BOOK"}, {"CARD"}, {"ELECTRONIC"}, {"FICHE"}, {"FILM"},
+    {"MAGAZINE"}, {"MANUSCRIPT"}, {"MAP "}, {"NEWSPAPER"}, {"OTHER"},
+    {"PHOTO"}, {"TOMBSTONE"}, {"VIDEO"},
+};
+static const GedTableEntry ged_enum_pedi[] = {
+    {"ADOPTED"}, {"BIRTH"}, {"FOSTER"}, {"OTHER"}, {"SEALING"},
+};
+static const GedTableEntry ged_enum_resn[] = {
+    {"CONFIDENTIAL"}, {"LOCKED"}, {"PRIVACY"},
+};
+static const GedTableEntry ged_enum_role[] = {
+    {"CHIL"}, {"CLERGY"}, {"FATH"}, {"FRIEND"}, {"GODP"}, {"HUSB"},
+    {"MOTH"}, {"NGHBR"}, {"OFFICIATOR"}, {"OTHER"}, {"PARENT"}, {"SPOU"},
+    {"WIFE"}, {"WITN"},
+};
+static const GedTableEntry ged_enum_sex[] = {
+    {"F"}, {"M"}, {"OTHER"}, {"U"}, {"X"},
+};
+static const GedTableEntry ged_enum_name_type[] = {
+    {"AKA"}, {"BIRTH"}, {"IMMIGRANT"}, {"MAIDEN"}, {"MARRIED"}, {"NICK"},
+    {"OTHER"}, {"PROFESSIONAL"},
+};
+static const GedTableEntry ged_enum_temple[] = {
+    {"BIC"}, {"CANCELED"}, {"CHILD"}, {"COMPLETED"}, {"DNS"}, {"DNS/CAN"},
+    {"EXCLUDED"}, {"INFANT"}, {"OTHER"}, {"PRE-1970"}, {"STILLBORN"},
+    {"SUBMITTED"}, {"UNCLEARED"},
+};
+static const struct {
+    const GedTableEntry *words;
+    size_t count;
+} ged_enum_vocab[] = {
+    [GED_ENUM_FAMC_ADOP] = {ged_enum_famc_adop, GED_TABLE_SIZE(ged_enum_famc_adop)},
+    [GED_ENUM_FAMC_STAT] = {ged_enum_famc_stat, GED_TABLE_SIZE(ged_enum_famc_stat)},
+    [GED_ENUM_MEDI] = {ged_enum_medi, GED_TABLE_SIZE(ged_enum_medi)},
+    [GED_ENUM_PEDI] = {ged_enum_pedi, GED_TABLE_SIZE(ged_enum_pedi)},
+    [GED_ENUM_RESN] = {ged_enum_resn, GED_TABLE_SIZE(ged_enum_resn)},
+    [GED_ENUM_ROLE] = {ged_enum_role, GED_TABLE_SIZE(ged_enum_role)},
+    [GED_ENUM_SEX] = {ged_enum_sex, GED_TABLE_SIZE(ged_enum_sex)},
+    [GED_ENUM_NAME_TYPE] = {ged_enum_name_type, GED_TABLE_SIZE(ged_enum_name_type)},
+    [GED_ENUM_TEMPLE] = {ged_enum_temple, GED_TABLE_SIZE(ged_enum_temple)},
+};
+
 /// simple state tracking; short to ensure it fits in a long
 struct ged_enum_state {
     short inside; // one of the above GED_ENUM_*
@@ -67,7 +121,7 @@ struct ged_enum_state {
  * 4. GED_END
  */
 void ged_enum_other_with_phrase(GedEvent *event, GedEmitterTemplate *emitter) {
-    GedEvent tmp;
+    GedEvent tmp = {0};
     
     tmp.type = GED_TEXT;
     tmp.flags = 0;
@@ -109,9 +163,10 @@ void ged_enum_as_tag(GedEvent *event, GedEmitterTemplate *emitter) {
 }
 
 /**
- * A lot of lookups to handle the known tags of each of nine different
- * enumerated types. Note that FILE.FORM, FONE.TYPE, and ROMN.TYPE are
- * all handled elsewhere, not in this function.
+ * Tracks which of nine different enumerated types a payload belongs
+ * to, if any, and looks it up in that type's `ged_enum_vocab`. Note
+ * that FILE.FORM, FONE.TYPE, and ROMN.TYPE are all handled elsewhere,
+ * not in this function.
  */
 void ged_enums(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     
@@ -120,26 +175,26 @@ void ged_enums(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
         state->nesting += 1;
         if (state->extnest || event->data[0] == '_')
         { state->extnest += 1; }
-        else if (!strcmp("FAMC", event->data))
+        else if (ged_tag(event) == GED_TAG_FAMC)
         { state->inside = GED_ENUM_FAMC; state->nesting = 0; }
-        else if (!strcmp("NAME", event->data))
+        else if (ged_tag(event) == GED_TAG_NAME)
         { state->inside = GED_ENUM_NAME; state->nesting = 0; }
-        else if (!strcmp("MEDI", event->data)) state->inside = GED_ENUM_MEDI;
-        else if (!strcmp("PEDI", event->data)) state->inside = GED_ENUM_PEDI;
-        else if (!strcmp("RESN", event->data)) state->inside = GED_ENUM_RESN;
-        else if (!strcmp("ROLE", event->data)) state->inside = GED_ENUM_ROLE;
-        else if (!strcmp("SEX", event->data)) state->inside = GED_ENUM_SEX;
-        else if (!strcmp("BAPL", event->data)
-              || !strcmp("CONL", event->data)
-              || !strcmp("ENDL", event->data)
-              || !strcmp("SLGC", event->data)
-              || !strcmp("SLGS", event->data)
+        else if (ged_tag(event) == GED_TAG_MEDI) state->inside = GED_ENUM_MEDI;
+        else if (ged_tag(event) == GED_TAG_PEDI) state->inside = GED_ENUM_PEDI;
+        else if (ged_tag(event) == GED_TAG_RESN) state->inside = GED_ENUM_RESN;
+        else if (ged_tag(event) == GED_TAG_ROLE) state->inside = GED_ENUM_ROLE;
+        else if (ged_tag(event) == GED_TAG_SEX) state->inside = GED_ENUM_SEX;
+        else if (ged_tag(event) == GED_TAG_BAPL
+              || ged_tag(event) == GED_TAG_CONL
+              || ged_tag(event) == GED_TAG_ENDL
+              || ged_tag(event) == GED_TAG_SLGC
+              || ged_tag(event) == GED_TAG_SLGS
             ) state->inside = GED_ENUM_TEMPLE;
         else if (state->inside == GED_ENUM_FAMC && state->nesting == 1) {
-            if (!strcmp("ADOP", event->data)) state->inside = GED_ENUM_FAMC_ADOP;
-            else if (!strcmp("STAT", event->data)) state->inside = GED_ENUM_FAMC_STAT;
+            if (ged_tag(event) == GED_TAG_ADOP) state->inside = GED_ENUM_FAMC_ADOP;
+            else if (ged_tag(event) == GED_TAG_STAT) state->inside = GED_ENUM_FAMC_STAT;
         } else if (state->inside == GED_ENUM_NAME && state->nesting == 1) {
-            if (!strcmp("TYPE", event->data)) state->inside = GED_ENUM_NAME_TYPE;
+            if (ged_tag(event) == GED_TAG_TYPE) state->inside = GED_ENUM_NAME_TYPE;
         } else {
             if (state->inside == GED_ENUM_FAMC_ADOP || state->inside == GED_ENUM_FAMC_STAT) state->inside = GED_ENUM_FAMC;
             else if (state->inside == GED_ENUM_NAME_TYPE) state->inside = GED_ENUM_NAME;
@@ -157,130 +212,12 @@ void ged_enums(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     }
     
     
-    if (event->type == GED_TEXT && (
-        state->inside != GED_ENUM_OTHER &&
-        state->inside != GED_ENUM_FAMC &&
-        state->inside != GED_ENUM_NAME
-    )) {
-        switch(state->inside) {
-            case GED_ENUM_FAMC_ADOP: {
-                if (strcasecmp("HUSB", event->data)
-                 && strcasecmp("WIFE", event->data)
-                 && strcasecmp("BOTH", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_FAMC_STAT: {
-                if (strcasecmp("CHALLENGED", event->data)
-                 && strcasecmp("DISPROVEN", event->data)
-                 && strcasecmp("PROVEN", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_MEDI: {
-                if (strcasecmp("AUDIO", event->data)
-                 && strcasecmp("BOOK", event->data)
-                 && strcasecmp("CARD", event->data)
-                 && strcasecmp("ELECTRONIC", event->data)
-                 && strcasecmp("FICHE", event->data)
-                 && strcasecmp("FILM", event->data)
-                 && strcasecmp("MAGAZINE", event->data)
-                 && strcasecmp("MANUSCRIPT", event->data)
-                 && strcasecmp("MAP ", event->data)
-                 && strcasecmp("NEWSPAPER", event->data)
-                 && strcasecmp("PHOTO", event->data)
-                 && strcasecmp("TOMBSTONE", event->data)
-                 && strcasecmp("VIDEO", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_PEDI: {
-                if (strcasecmp("ADOPTED", event->data)
-                 && strcasecmp("BIRTH", event->data)
-                 && strcasecmp("FOSTER", event->data)
-                 && strcasecmp("SEALING", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_RESN: {
-                if (strcasecmp("CONFIDENTIAL", event->data)
-                 && strcasecmp("LOCKED", event->data)
-                 && strcasecmp("PRIVACY", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_ROLE: {
-                if (strcasecmp("CHIL", event->data)
-                 && strcasecmp("HUSB", event->data)
-                 && strcasecmp("WIFE", event->data)
-                 && strcasecmp("MOTH", event->data)
-                 && strcasecmp("FATH", event->data)
-                 && strcasecmp("SPOU", event->data)
-                 && strcasecmp("CLERGY", event->data)
-                 && strcasecmp("FRIEND", event->data)
-                 && strcasecmp("GODP", event->data)
-                 && strcasecmp("NGHBR", event->data)
-                 && strcasecmp("OFFICIATOR", event->data)
-                 && strcasecmp("PARENT", event->data)
-                 && strcasecmp("WITN", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_SEX: {
-                if (strcasecmp("M", event->data)
-                 && strcasecmp("F", event->data)
-                 && strcasecmp("U", event->data)
-                 && strcasecmp("X", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_NAME_TYPE: {
-                if (strcasecmp("AKA", event->data)
-                 && strcasecmp("BIRTH", event->data)
-                 && strcasecmp("IMMIGRANT", event->data)
-                 && strcasecmp("MAIDEN", event->data)
-                 && strcasecmp("MARRIED", event->data)
-                 && strcasecmp("NICK", event->data)
-                 && strcasecmp("PROFESSIONAL", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_TEMPLE: {
-                if (strcasecmp("BIC", event->data)
-                 && strcasecmp("CANCELED", event->data)
-                 && strcasecmp("CHILD", event->data)
-                 && strcasecmp("COMPLETED", event->data)
-                 && strcasecmp("DNS", event->data)
-                 && strcasecmp("DNS/CAN", event->data)
-                 && strcasecmp("EXCLUDED", event->data)
-                 && strcasecmp("INFANT", event->data)
-                 && strcasecmp("PRE-1970", event->data)
-                 && strcasecmp("STILLBORN", event->data)
-                 && strcasecmp("SUBMITTED", event->data)
-                 && strcasecmp("UNCLEARED", event->data)
-                 && strcasecmp("OTHER", event->data))
-                    ged_enum_other_with_phrase(event, emitter);
-                else
-                    ged_enum_as_tag(event, emitter);
-            } break;
-            case GED_ENUM_FAMC: case GED_ENUM_NAME: case GED_ENUM_OTHER:
-                emitter->emit(emitter, *event);
-        }
+    if (event->type == GED_TEXT && ged_enum_vocab[state->inside].words) {
+        if (gedTable_find(ged_enum_vocab[state->inside].words, 
+            ged_enum_vocab[state->inside].count, event->data, strcasecmp))
+            ged_enum_as_tag(event, emitter);
+        else
+            ged_enum_other_with_phrase(event, emitter);
     } else {
         emitter->emit(emitter, *event);
     }
@@ -1,53 +1,72 @@
 /**
- * Given a parsed event-stream, assembles records into tree structure
+ * Given a parsed event-stream, assembles records into `GedRecord`s
  * and emits only GED_RECORD-type events, one per record in the input.
  * 
  * Must happen *after* `ged_merge` or some text will be lost.
  */
 
 #include <assert.h>
+#include <string.h>
 
 struct ged_event2record_state {
-    // the set of structs that have been opened but not yet closed
-    // fixed-size 100 motivated by GEDCOM 5.5.1's levels being [0..99]
-    // +1 because GED_END a level-99 will try to zero out level-100
-    GedStructure *open[100];
-    int depth; // index of first open spot in `open`
+    GedRecord *record; // the record being assembled, if any
+    // the innermost structure opened but not yet closed, or -1; those
+    // enclosing it are found by its `parent` links, so depth is unlimited
+    int32_t open;
+    int32_t prev; // the last closed substructure of `open`, or -1
 };
 
+/// the data of `event`, moved into `arena` if the event owned it
+static char *ged_event2record_keep(GedEvent *event, GedArena *arena) {
+    char *data = event->data;
+    if (data && (event->flags & GED_OWNS_DATA)) {
+        data = gedArena_strndup(arena, data, strlen(data));
+        free(event->data);
+        event->flags &= ~GED_OWNS_DATA;
+    }
+    event->data = 0;
+    return data;
+}
+
 void ged_event2record(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     struct ged_event2record_state *state = (struct ged_event2record_state *)rawstate;
     
     switch(event->type) {
         case GED_START: {
-            GedStructure *s = calloc(1, sizeof(GedStructure));
-            s->tag = *event;
-            if (state->open[state->depth]) {
-                state->open[state->depth]->sibling = s;
-            } else if (state->depth > 0) {
-                state->open[state->depth-1]->child = s;
-            } else { /* record, nothing to attach it too */ }
-            state->open[state->depth++] = s;
+            if (!state->record) state->record = gedRecord_create(emitter->arena);
+            int tag = ged_tag(event);
+            state->open = gedRecord_add(state->record, emitter->arena,
+                state->open, state->prev, tag,
+                ged_event2record_keep(event, emitter->arena));
+            state->prev = -1;
         } break;
         case GED_ANCHOR: {
-            assert(state->depth > 0);
-            state->open[state->depth-1]->anchor = *event;
+            assert(state->open >= 0);
+            // 5.5.1 only lets records be pointed to, so only they keep anchors
+            if (state->open == 0)
+                state->record->anchor = ged_event2record_keep(event, emitter->arena);
+            else
+                ged_destroy_event(event);
         } break;
         case GED_TEXT: case GED_POINTER: {
-            assert(state->depth > 0);
-            assert(state->open[state->depth-1]->payload.type == GED_UNUSED);
-            state->open[state->depth-1]->payload = *event;
+            assert(state->open >= 0);
+            GedNode *n = state->record->nodes + state->open;
+            assert(n->type == GED_UNUSED);
+            n->type = event->type;
+            n->payload = ged_event2record_keep(event, emitter->arena);
+            n->len = n->payload ? strlen(n->payload) : 0;
         } break;
         case GED_END: {
-            assert(state->depth > 0);
-            state->open[state->depth--] = 0;
-            if (state->depth == 0) {
+            assert(state->open >= 0);
+            state->prev = state->open;
+            state->open = state->record->nodes[state->open].parent;
+            if (state->open < 0) {
                 ged_destroy_event(event);
                 event->type = GED_RECORD;
-                event->flags = GED_OWNS_DATA;
-                event->record = state->open[0];
+                event->record = state->record;
                 emitter->emit(emitter, *event);
-                state->open[0] = 0;
+                state->record = 0;
+                state->prev = -1;
             }
         } break;
         case GED_UNUSED: case GED_EOF: case GED_ERROR: case GED_RECORD: {
@@ -58,12 +77,10 @@ void ged_event2record(GedEvent *event, GedEmitterTemplate *emitter, void *rawsta
 }
 
 void *ged_event2recordstate_maker() { 
-    return calloc(1, sizeof(struct ged_event2record_state));
-    
+    struct ged_event2record_state *state = calloc(1, sizeof(struct ged_event2record_state));
+    state->open = state->prev = -1;
+    return state;
 }
 void ged_event2recordstate_freer(void *rawstate) { 
-    struct ged_event2record_state *state = (struct ged_event2record_state *)rawstate;
-    if (state->open[0]) ged_destroy_structure(state->open[0]);
-    free(rawstate);
+    free(rawstate); // any record in progress is in an arena
 }
-
@@ -4,12 +4,15 @@
  * RFN X -> EXID X + TYPE gedcom551:RFN
  * RIN X -> EXID X + TYPE gedcom551:RIN/<HEAD.SOUR>
  * AFN X -> EXID X + TYPE gedcom551:AFN
+ *
+ * Pass 1 is the same as pass 2 and is run only to learn HEAD.SOUR, so
+ * that with more than one thread every copy of the state knows it.
  */
 
 struct ged_exidstate {
     char *head_sour;
     char inside;
-    char nested_level;
+    int nested_level;
 };
 
 #define GED_EXID_HEAD 1
@@ -29,33 +32,21 @@ void ged_exid(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
         else if (state->inside > GED_EXID_HEAD) state->inside = 0;
         else if (state->inside) state->nested_level += 1;
 
-        if (state->inside == GED_EXID_HEAD && !strcmp("SOUR",event->data)) {
+        if (state->inside == GED_EXID_HEAD && ged_tag(event) == GED_TAG_SOUR) {
             state->inside = GED_EXID_HEAD_SOUR;
         } else if (!state->inside) {
-            if (!strcmp("RFN", event->data)) {
-                state->inside = GED_EXID_RFN;
-                changePayloadToConst(event, "EXID");
+            switch(ged_tag(event)) {
+                case GED_TAG_RFN: state->inside = GED_EXID_RFN; break;
+                case GED_TAG_RIN: state->inside = GED_EXID_RIN; break;
+                case GED_TAG_AFN: state->inside = GED_EXID_AFN; break;
+                case GED_TAG__FSFTID: case GED_TAG__FID: case GED_TAG_FSFTID:
+                    state->inside = GED_EXID_FSFTID; break;
+                // add HISTID? Used by FTW5
+                case GED_TAG__APID: state->inside = GED_EXID_APID; break;
+                case GED_TAG_HEAD: state->inside = GED_EXID_HEAD; break;
             }
-            else if (!strcmp("RIN", event->data)) {
-                state->inside = GED_EXID_RIN;
-                changePayloadToConst(event, "EXID");
-            }
-            else if (!strcmp("AFN", event->data)) {
-                state->inside = GED_EXID_AFN;
-                changePayloadToConst(event, "EXID");
-            }
-            else if (!strcmp("_FSFTID", event->data) 
-                 || !strcmp("_FID", event->data)
-                 || !strcmp("FSFTID", event->data)) {
-                state->inside = GED_EXID_FSFTID;
-                changePayloadToConst(event, "EXID");
-            }
-            // add HISTID? Used by FTW5
-            else if (!strcmp("_APID", event->data)) {
-                state->inside = GED_EXID_APID;
-                changePayloadToConst(event, "EXID");
-            }
-            else if (!strcmp("HEAD", event->data)) state->inside = GED_EXID_HEAD;
+            if (state->inside > GED_EXID_HEAD_SOUR)
+                changeTagTo(event, GED_TAG_EXID);
         }
     }
     if (event->type == GED_END) {
@@ -65,6 +56,7 @@ void ged_exid(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     
     if (event->type == GED_TEXT && state->inside > GED_EXID_HEAD) {
         if (state->inside == GED_EXID_HEAD_SOUR) {
+            free(state->head_sour);
             state->head_sour = strdup(event->data);
         }
         else {
@@ -103,6 +95,28 @@ void ged_exid(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
 #undef GED_EXID_AFN
 
 
+/// saves HEAD.SOUR as pass 1 left it: a line with its length (or -1 if
+/// there was none) followed by it
+void ged_exid_save(const void *rawstate, FILE *to) {
+    const struct ged_exidstate *state = (const struct ged_exidstate *)rawstate;
+    if (!state->head_sour) fprintf(to, "-1\n");
+    else fprintf(to, "%zu\n%s\n", strlen(state->head_sour), state->head_sour);
+}
+
+/// loads what `ged_exid_save` wrote, as if pass 1 had run
+int ged_exid_load(void *rawstate, FILE *from) {
+    struct ged_exidstate *state = (struct ged_exidstate *)rawstate;
+    long len;
+    if (fscanf(from, "%ld", &len) != 1 || fgetc(from) != '\n') return 1;
+    if (len < 0) return 0;
+    char *sour = malloc(len+1);
+    if (fread(sour, 1, len, from) != (size_t)len || fgetc(from) != '\n') { free(sour); return 1; }
+    sour[len] = 0;
+    free(state->head_sour);
+    state->head_sour = sour;
+    return 0;
+}
+
 void *ged_exidstate_maker() { 
     struct ged_exidstate *ans = calloc(1, sizeof(struct ged_exidstate));
     return ans;
@@ -17,7 +17,7 @@
 void ged_filenames(GedEvent *event, GedEmitterTemplate *emitter, void *state) {
     long *isFILE = (long *)state;
     if (event->type == GED_START)
-        *isFILE = !strcmp("FILE", event->data);
+        *isFILE = ged_tag(event) == GED_TAG_FILE;
     if (*isFILE && event->type == GED_TEXT) {
         int needed = 0;
         if (event->data[0] == '/') needed += 7;
@@ -11,13 +11,14 @@
 /**
  * 1 if `s` is a legal xref:id for GEDCOM 7.0; 0 otherwise
  * But with extra check; X[0-9]+ IDs are generated by this tool
- * so they need to be changed if encountered to avoid collision
+ * so they need to be changed if encountered to avoid collision.
+ * If `icase` is nonzero, `s` is upper-cased first.
  */
-int ged_fixid_isOK(char *s) {
+int ged_fixid_isOK(char *s, int icase) {
     if (!*s) return 0;
-    int isXNum = *s == 'X' || (ged_xref_case_insensitive && *s == 'x');
+    int isXNum = *s == 'X' || (icase && *s == 'x');
     while(*s) {
-        if (ged_xref_case_insensitive) *s = toupper(*s);
+        if (icase) *s = toupper(*s);
         if (!( (*s >= '0' && *s <= '9') 
             || (*s >= 'A' && *s <= 'Z')
             || (*s == '_')
@@ -40,14 +41,18 @@ void ged_fixid(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     trie *state = (trie *)rawstate;
     
     if ((event->type == GED_ANCHOR || event->type == GED_POINTER)
-    && !ged_fixid_isOK(event->data)) {
+    && !ged_fixid_isOK(event->data, emitter->options->xref_case_insensitive)) {
         char *val = trie_get(state, event->data);
         if (!val) {
             int n = ged_fixid_digitsneeded(state->length+1);
             val = malloc(n+2);
             snprintf(val, n+2, "X%zu", state->length+1);
-            trie_put(state, event->data, val);
-            event->flags &= ~GED_OWNS_DATA;
+            if (event->flags & GED_OWNS_DATA) {
+                trie_put(state, event->data, val);
+                event->flags &= ~GED_OWNS_DATA;
+            } else { // key must outlive the record
+                trie_put(state, strdup(event->data), val);
+            }
         }
         if (event->flags & GED_OWNS_DATA) {
             free(event->data);
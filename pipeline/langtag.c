@@ -10,11 +10,101 @@
  * and after `ged_merge` to handle split-payload ages.
  */
 
-#include "../strtrie.h"
+#include "../gedtable.h"
 #include <string.h> // for strcmp
+#include <assert.h>
+
+/// lower-case language names to BCP 47 tags, sorted by name
+static const GedTableEntry ged_langtag_table[] = {
+    {"afrikaans", "af"},
+    {"albanian", "sq"},
+    {"amharic", "am"},
+    {"anglo-saxon", "ang"},
+    {"arabic", "ar"},
+    {"armenian", "hy"},
+    {"assamese", "as"},
+    {"belorusian", "be"},
+    {"bengali", "bn"},
+    {"braj", "bra"},
+    {"bulgarian", "bg"},
+    {"burmese", "my"},
+    {"cantonese", "yue"}, // or zh-yue
+    {"catalan", "ca"},
+    {"catalan_spn", "ca-es"}, // not a language?
+    {"church-slavic", "cu"},
+    {"czech", "cs"},
+    {"danish", "da"},
+    {"dogri", "dgr"},
+    {"dutch", "nl"},
+    {"english", "en"},
+    {"esperanto", "eo"},
+    {"estonian", "et"},
+    {"faroese", "fo"},
+    {"finnish", "fi"},
+    {"french", "fr"},
+    {"georgian", "ka"},
+    {"german", "de"},
+    {"greek", "el"},
+    {"gujarati", "gu"},
+    {"hawaiian", "haw"},
+    {"hebrew", "be"},
+    {"hindi", "hi"},
+    {"hungarian", "hu"},
+    {"icelandic", "is"},
+    {"indonesian", "id"},
+    {"italian", "it"},
+    {"japanese", "ja"},
+    {"kannada", "kn"},
+    {"khmer", "km"},
+    {"konkani", "kok"},
+    {"korean", "ko"},
+    {"lahnda", "lah"},
+    {"lao", "lo"},
+    {"latvian", "lv"},
+    {"lithuanian", "lt"},
+    {"macedonian", "mk"},
+    {"maithili", "mai"},
+    {"malayalam", "ml"},
+    {"mandrin", "cmn"}, // or zh-cmn
+    {"manipuri", "mni"},
+    {"marathi", "mr"},
+    {"mewari", "mtr"},
+    {"navaho", "nv"},
+    {"nepali", "ne"},
+    {"norwegian", "no"}, // or nb nn, rmg
+    {"oriya", "or"},
+    {"pahari", "him"}, // or bfz, kfx, mjt, mkb, phr
+    {"pali", "pi"},
+    {"panjabi", "pa"},
+    {"persian", "fa"},
+    {"polish", "pl"},
+    {"portuguese", "pt"},
+    {"prakrit", "pra"},
+    {"pusto", "ps"},
+    {"rajasthani", "raj"},
+    {"romanian", "ro"},
+    {"russian", "ru"},
+    {"sanskrit", "sa"},
+    {"serb", "sr"},
+    {"serbo_croa", "sh"}, // or bs, hr, sr, cnr
+    {"slovak", "sk"},
+    {"slovene", "sl"},
+    {"spanish", "es"},
+    {"swedish", "sv"},
+    {"tagalog", "tl"},
+    {"tamil", "ta"},
+    {"telugu", "te"},
+    {"thai", "th"},
+    {"tibetan", "bo"},
+    {"turkish", "tr"},
+    {"ukrainian", "uk"},
+    {"urdu", "ur"},
+    {"vietnamese", "vi"},
+    {"wendic", "wen"},
+    {"yiddish", "yi"},
+};
 
 struct ged_langtagstate {
-    trie lookup;
     int inLANG;
 };
 
@@ -30,14 +120,14 @@ void ged_langtag(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     struct ged_langtagstate *state = (struct ged_langtagstate *)rawstate;
     
     if (event->type == GED_START)
-        state->inLANG = !strcmp("LANG", event->data);
+        state->inLANG = ged_tag(event) == GED_TAG_LANG;
     if (state->inLANG && event->type == GED_TEXT) {
         make_lower_case(event->data);
-        const char *bcp47 = trie_get(&state->lookup, event->data);
+        const GedTableEntry *bcp47 = gedTable_find(ged_langtag_table, GED_TABLE_SIZE(ged_langtag_table), event->data, strcmp);
         if (bcp47) {
             ged_destroy_event(event);
             event->type = GED_TEXT;
-            event->data = (char *)bcp47; // NOT owned
+            event->data = (char *)bcp47->val; // NOT owned
         } else {
             /* from 
              *  n LANG something
@@ -45,7 +135,7 @@ void ged_langtag(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
              *  n LANG und
              *  n+1 PHRASE something
              */
-            GedEvent tmp;
+            GedEvent tmp = {0};
             tmp.type = GED_TEXT;
             tmp.data = "und";
             tmp.flags = 0; // NOT owned
@@ -65,98 +155,10 @@ void ged_langtag(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
 }
 
 void *ged_langtagstate_maker() { 
-    struct ged_langtagstate *ans = calloc(1, sizeof(struct ged_langtagstate));
-    trie_put(&ans->lookup, "afrikaans", "af");
-    trie_put(&ans->lookup, "albanian", "sq");
-    trie_put(&ans->lookup, "amharic", "am");
-    trie_put(&ans->lookup, "anglo-saxon", "ang");
-    trie_put(&ans->lookup, "arabic", "ar");
-    trie_put(&ans->lookup, "armenian", "hy");
-    trie_put(&ans->lookup, "assamese", "as");
-    trie_put(&ans->lookup, "belorusian", "be");
-    trie_put(&ans->lookup, "bengali", "bn");
-    trie_put(&ans->lookup, "braj", "bra");
-    trie_put(&ans->lookup, "bulgarian", "bg");
-    trie_put(&ans->lookup, "burmese", "my");
-    trie_put(&ans->lookup, "cantonese", "yue"); // or zh-yue
-    trie_put(&ans->lookup, "catalan", "ca");
-    trie_put(&ans->lookup, "catalan_spn", "ca-es"); // not a language?
-    trie_put(&ans->lookup, "church-slavic", "cu");
-    trie_put(&ans->lookup, "czech", "cs");
-    trie_put(&ans->lookup, "danish", "da");
-    trie_put(&ans->lookup, "dogri", "dgr");
-    trie_put(&ans->lookup, "dutch", "nl");
-    trie_put(&ans->lookup, "english", "en");
-    trie_put(&ans->lookup, "esperanto", "eo");
-    trie_put(&ans->lookup, "estonian", "et");
-    trie_put(&ans->lookup, "faroese", "fo");
-    trie_put(&ans->lookup, "finnish", "fi");
-    trie_put(&ans->lookup, "french", "fr");
-    trie_put(&ans->lookup, "georgian", "ka");
-    trie_put(&ans->lookup, "german", "de");
-    trie_put(&ans->lookup, "greek", "el");
-    trie_put(&ans->lookup, "gujarati", "gu");
-    trie_put(&ans->lookup, "hawaiian", "haw");
-    trie_put(&ans->lookup, "hebrew", "be");
-    trie_put(&ans->lookup, "hindi", "hi");
-    trie_put(&ans->lookup, "hungarian", "hu");
-    trie_put(&ans->lookup, "icelandic", "is");
-    trie_put(&ans->lookup, "indonesian", "id");
-    trie_put(&ans->lookup, "italian", "it");
-    trie_put(&ans->lookup, "japanese", "ja");
-    trie_put(&ans->lookup, "kannada", "kn");
-    trie_put(&ans->lookup, "khmer", "km");
-    trie_put(&ans->lookup, "konkani", "kok");
-    trie_put(&ans->lookup, "korean", "ko");
-    trie_put(&ans->lookup, "lahnda", "lah");
-    trie_put(&ans->lookup, "lao", "lo");
-    trie_put(&ans->lookup, "latvian", "lv");
-    trie_put(&ans->lookup, "lithuanian", "lt");
-    trie_put(&ans->lookup, "macedonian", "mk");
-    trie_put(&ans->lookup, "maithili", "mai");
-    trie_put(&ans->lookup, "malayalam", "ml");
-    trie_put(&ans->lookup, "mandrin", "cmn"); // or zh-cmn
-    trie_put(&ans->lookup, "manipuri", "mni");
-    trie_put(&ans->lookup, "marathi", "mr");
-    trie_put(&ans->lookup, "mewari", "mtr");
-    trie_put(&ans->lookup, "navaho", "nv");
-    trie_put(&ans->lookup, "nepali", "ne");
-    trie_put(&ans->lookup, "norwegian", "no"); // or nb nn, rmg
-    trie_put(&ans->lookup, "oriya", "or");
-    trie_put(&ans->lookup, "pahari", "him"); // or bfz, kfx, mjt, mkb, phr
-    trie_put(&ans->lookup, "pali", "pi");
-    trie_put(&ans->lookup, "panjabi", "pa");
-    trie_put(&ans->lookup, "persian", "fa");
-    trie_put(&ans->lookup, "polish", "pl");
-    trie_put(&ans->lookup, "portuguese", "pt");
-    trie_put(&ans->lookup, "prakrit", "pra");
-    trie_put(&ans->lookup, "pusto", "ps");
-    trie_put(&ans->lookup, "rajasthani", "raj");
-    trie_put(&ans->lookup, "romanian", "ro");
-    trie_put(&ans->lookup, "russian", "ru");
-    trie_put(&ans->lookup, "sanskrit", "sa");
-    trie_put(&ans->lookup, "serb", "sr");
-    trie_put(&ans->lookup, "serbo_croa", "sh"); // or bs, hr, sr, cnr
-    trie_put(&ans->lookup, "slovak", "sk");
-    trie_put(&ans->lookup, "slovene", "sl");
-    trie_put(&ans->lookup, "spanish", "es");
-    trie_put(&ans->lookup, "swedish", "sv");
-    trie_put(&ans->lookup, "tagalog", "tl");
-    trie_put(&ans->lookup, "tamil", "ta");
-    trie_put(&ans->lookup, "telugu", "te");
-    trie_put(&ans->lookup, "thai", "th");
-    trie_put(&ans->lookup, "tibetan", "bo");
-    trie_put(&ans->lookup, "turkish", "tr");
-    trie_put(&ans->lookup, "ukrainian", "uk");
-    trie_put(&ans->lookup, "urdu", "ur");
-    trie_put(&ans->lookup, "vietnamese", "vi");
-    trie_put(&ans->lookup, "wendic", "wen");
-    trie_put(&ans->lookup, "yiddish", "yi");
-    return ans;
+    assert(gedTable_sorted(ged_langtag_table, GED_TABLE_SIZE(ged_langtag_table), strcmp));
+    return calloc(1, sizeof(struct ged_langtagstate));
 }
 void ged_langtagstate_freer(void *state) { 
-    struct ged_langtagstate *ans = (struct ged_langtagstate *)state;
-    trie_free(&ans->lookup);
     free(state); 
 }
 
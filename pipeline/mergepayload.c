@@ -8,51 +8,83 @@
 
 #include <string.h> // strlen, memcpy
 
+/// one GED_TEXT (or, if `data` is NULL, a GED_LINEBREAK) of a payload
+struct ged_merge_segment {
+    char *data;
+    size_t len;
+    int owned; // if data was the event's to free
+};
+
+/**
+ * The pieces of the payload so far, kept as they came and copied only
+ * once, when the payload ends, so that a payload of many CONT and CONC
+ * lines costs one allocation instead of one per line.
+ */
 struct ged_mergestate {
-    char *accumulator;
-    size_t used;
+    struct ged_merge_segment *segments;
+    size_t count, cap; // `segments` is reused from one payload to the next
+    size_t used; // total bytes in all segments
 };
 
+/// emits the payload collected so far, if any, as one GED_TEXT
+static void ged_merge_flush(struct ged_mergestate *state, GedEmitterTemplate *emitter) {
+    if (!state->count) return;
+    GedEvent ans = {0};
+    ans.type = GED_TEXT;
+    struct ged_merge_segment *seg = state->segments;
+    if (state->count == 1 && seg->data) {
+        // a single piece needs no copy
+        ans.data = seg->data;
+        ans.flags = seg->owned ? GED_OWNS_DATA : 0;
+    } else {
+        ans.data = malloc(state->used + 1);
+        ans.flags = GED_OWNS_DATA;
+        char *end = ans.data;
+        for(size_t i=0; i<state->count; i+=1) {
+            if (seg[i].data) {
+                memcpy(end, seg[i].data, seg[i].len);
+                if (seg[i].owned) free(seg[i].data);
+            } else {
+                *end = '\n';
+            }
+            end += seg[i].len;
+        }
+        *end = '\0';
+    }
+    emitter->emit(emitter, ans);
+    state->count = 0;
+    state->used = 0;
+}
+
+/// adds a piece to the payload, taking over `data` if `owned`
+static void ged_merge_add(struct ged_mergestate *state, char *data, size_t len, int owned) {
+    if (state->count >= state->cap) {
+        state->cap = state->cap ? state->cap*2 : 16;
+        state->segments = realloc(state->segments, sizeof(struct ged_merge_segment)*state->cap);
+    }
+    state->segments[state->count].data = data;
+    state->segments[state->count].len = len;
+    state->segments[state->count].owned = owned;
+    state->count += 1;
+    state->used += len;
+}
+
 void ged_merge(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     struct ged_mergestate *state = (struct ged_mergestate *)rawstate;
     
-    if (state->accumulator && (event->type == GED_START || event->type == GED_END)) {
-        GedEvent ans;
-        ans.data = state->accumulator;
-        ans.type = GED_TEXT;
-        ans.flags = GED_OWNS_DATA;
-        emitter->emit(emitter, ans);
-        state->accumulator = 0;
-        state->used = 0;
-    }
+    if (event->type == GED_START || event->type == GED_END)
+        ged_merge_flush(state, emitter);
     
     if (event->type == GED_TEXT) {
-        if (event->data) {
-            size_t more = strlen(event->data);
-            if (more > 0) {
-                if (!state->accumulator && (event->flags & GED_OWNS_DATA)) {
-                    state->accumulator = event->data;
-                    state->used = more;
-                    event->data = 0;
-                    event->flags &= ~GED_OWNS_DATA;
-                } else {
-                    state->accumulator = realloc(state->accumulator, more + state->used + 1);
-                    memcpy(state->accumulator + state->used, event->data, more + 1);
-                    state->used += more;
-                }
-            }
+        size_t more = event->data ? strlen(event->data) : 0;
+        if (more > 0) {
+            ged_merge_add(state, event->data, more, event->flags & GED_OWNS_DATA);
+            event->data = 0;
+            event->flags &= ~GED_OWNS_DATA;
         }
         ged_destroy_event(event);
     } else if (event->type == GED_LINEBREAK) {
-        if (!state->accumulator) {
-            state->accumulator = calloc(2, sizeof(char));
-            state->accumulator[0] = '\n';
-            state->used = 1;
-        } else {
-            state->accumulator = realloc(state->accumulator, state->used+2);
-            state->accumulator[state->used++] = '\n';
-            state->accumulator[state->used] = '\0';
-        }
+        ged_merge_add(state, 0, 1, 0);
         ged_destroy_event(event);
     } else {
         emitter->emit(emitter, *event);
@@ -65,59 +97,8 @@ void *ged_mergestate_maker() {
 }
 void ged_mergestate_freer(void *state) { 
     struct ged_mergestate *ans = (struct ged_mergestate *)state;
-    if (ans->accumulator) free(ans->accumulator);
+    for(size_t i=0; i<ans->count; i+=1)
+        if (ans->segments[i].owned) free(ans->segments[i].data);
+    free(ans->segments);
     free(state); 
 }
-
-#ifndef _GNU_SOURCE
-/**
- * Polyfill for strchrnull GNU extension
- */
-char *strchrnul(char *s, char c) {
-    while(*s && *s != c) s+=1;
-    return s;
-}
-#endif
-
-/**
- * Turns "\n" into GED_LINEBREAK, potentially turning one GED_TEXT into any number of GED_TEXT and GED_LINEBREAK events.
- * 
- * In principle this could be done with no `malloc` calls by having only
- * the last event own the string. However `free` needs the first event
- * to be the one that GED_OWNS_DATA, which means the second and beyond
- * won't work. This could be fixed with additional state (e.g., a second
- * pointer in each GED_EVENT) but this instead `malloc`s each GED_TEXT
- * payload, freeing the original.
- */
-void ged_unmerge(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
-    
-    if (event->type == GED_TEXT) {
-        GedEvent tmp;
-        char *strp = event->data;
-        char *nl = strchrnul(strp, '\n');
-        if (*nl) {
-            for(;;) {
-                size_t len = nl-strp;
-                if (len > 1) {
-                    tmp.flags = GED_OWNS_DATA;
-                    tmp.type = GED_TEXT;
-                    tmp.data = malloc(len+1);
-                    memcpy(tmp.data, strp, len);
-                    tmp.data[len] = 0;
-                    emitter->emit(emitter, tmp);
-                }
-                if (*nl) {
-                    tmp.flags = 0;
-                    tmp.type = GED_LINEBREAK;
-                    tmp.data = 0;
-                    emitter->emit(emitter, tmp);
-                } else break;
-                strp = nl+1;
-                nl = strchrnul(strp, '\n');
-            }
-            ged_destroy_event(event);
-            return;
-        }
-    }
-    emitter->emit(emitter, *event);
-}
@@ -52,82 +52,92 @@
 
 
 /**
- * Given a 5.5.1-style personal name (NAME, FONE, or ROMN),
+ * Given a 5.5.1-style personal name (NAME, FONE, or ROMN) at index `i`,
  * modifies it into a 7.0-style personal name (without changing tag).
- * If this is inexact, returns a NOTE as well; if exact, returns null.
+ * If this is inexact, adds a NOTE after it and returns the NOTE's
+ * index; if exact, returns -1.
  */
-GedStructure *ged_names_helper(GedStructure *s) {
+int32_t ged_names_helper(GedRecord *r, int32_t i, GedArena *arena) {
     // move the entire payload into a PART
-    GedStructure *part = calloc(1, sizeof(GedStructure));
-    part->payload = s->payload;
-    part->tag.data = "PART";
-    s->payload.flags &= ~GED_OWNS_DATA;
-    s->payload.data = 0;
+    int32_t part = gedRecord_add(r, arena, i, -1, GED_TAG_EXTENSION, "PART");
+    r->nodes[part].payload = r->nodes[i].payload;
+    r->nodes[part].len = r->nodes[i].len;
+    r->nodes[part].type = r->nodes[i].type;
+    r->nodes[i].payload = 0;
+    r->nodes[i].len = 0;
+    r->nodes[i].type = GED_UNUSED;
     #warning "have not yet handled /surname/"
     
     // prep null holder for note
-    GedStructure *note = 0;
+    int32_t note = -1;
     
     // iterate through substructures, looking for name parts and translations
-    GedStructure **owner = &s->child;
-    for(GedStructure *ss = *owner; ss; owner = &ss->sibling, ss = *owner) {
-        if (!strcmp("FONE",ss->tag.data)) {
+    for(int32_t ss = r->nodes[part].next; ss >= 0; ss = r->nodes[ss].next) {
+        if (r->nodes[ss].tag == GED_TAG_FONE) {
             // change TYPE to LANG
-            for(GedStructure *s3 = ss->child; s3; s3 = s3->sibling) {
-                if (!strcmp("TYPE", s3->tag.data)) {
-                    changePayloadToConst(&(s3->tag), "LANG");
-                    if (!strcmp("hangul", s3->payload.data)) {
-                        changePayloadToConst(&(s3->payload), "ko-hang");
-                    } else if (!strcmp("kana", s3->payload.data)) {
-                        changePayloadToConst(&(s3->payload), "jp-hrki");
+            for(int32_t s3 = r->nodes[ss].child; s3 >= 0; s3 = r->nodes[s3].next) {
+                GedNode *n = r->nodes + s3;
+                if (n->tag == GED_TAG_TYPE) {
+                    n->tag = GED_TAG_LANG;
+                    n->tagname = gedTag_name(GED_TAG_LANG);
+                    if (!strcmp("hangul", n->payload)) {
+                        n->payload = "ko-hang";
+                    } else if (!strcmp("kana", n->payload)) {
+                        n->payload = "jp-hrki";
                     } else {
-                        char *payload = calloc(12+strlen(s3->payload.data), 1);
-                        sprintf(payload, "x-phonetic-%s", s3->payload.data);
-                        changePayloadToDynamic(&(s3->payload), payload);
+                        char *payload = gedArena_alloc(arena, 12+n->len);
+                        sprintf(payload, "x-phonetic-%s", n->payload);
+                        n->payload = payload;
                     }
+                    n->len = strlen(n->payload);
                 }
             }
             // and handle that it's a name
-            GedStructure *tmp = ged_names_helper(ss);
-            if (tmp) { tmp->sibling = note; note = tmp; }
+            int32_t tmp = ged_names_helper(r, ss, arena);
             // then change tag
-            changePayloadToConst(&(ss->tag), "TRAN");
-        } else if (!strcmp("ROMN",ss->tag.data)) {
+            r->nodes[ss].tag = GED_TAG_TRAN;
+            r->nodes[ss].tagname = gedTag_name(GED_TAG_TRAN);
+            if (tmp >= 0) { note = tmp; ss = tmp; }
+        } else if (r->nodes[ss].tag == GED_TAG_ROMN) {
             // change TYPE to LANG
-            for(GedStructure *s3 = ss->child; s3; s3 = s3->sibling) {
-                if (!strcmp("TYPE", s3->tag.data)) {
-                    changePayloadToConst(&(s3->tag), "LANG");
-                    if (!strcmp("pinyin", s3->payload.data)) {
-                        changePayloadToConst(&(s3->payload), "und-Latn-pinyin");
-                    } else if (!strcmp("romanji", s3->payload.data)) {
-                        changePayloadToConst(&(s3->payload), "jp-Latn");
-                    } else if (!strcmp("wadegiles", s3->payload.data)) {
-                        changePayloadToConst(&(s3->payload), "zh-Latn-wadegile");
+            for(int32_t s3 = r->nodes[ss].child; s3 >= 0; s3 = r->nodes[s3].next) {
+                GedNode *n = r->nodes + s3;
+                if (n->tag == GED_TAG_TYPE) {
+                    n->tag = GED_TAG_LANG;
+                    n->tagname = gedTag_name(GED_TAG_LANG);
+                    if (!strcmp("pinyin", n->payload)) {
+                        n->payload = "und-Latn-pinyin";
+                    } else if (!strcmp("romanji", n->payload)) {
+                        n->payload = "jp-Latn";
+                    } else if (!strcmp("wadegiles", n->payload)) {
+                        n->payload = "zh-Latn-wadegile";
                     } else {
-                        char *payload = calloc(12+strlen(s3->payload.data), 1);
-                        sprintf(payload, "und-Latn-x-%s", s3->payload.data);
-                        changePayloadToDynamic(&(s3->payload), payload);
+                        char *payload = gedArena_alloc(arena, 12+n->len);
+                        sprintf(payload, "und-Latn-x-%s", n->payload);
+                        n->payload = payload;
                     }
+                    n->len = strlen(n->payload);
                 }
             }
             // and handle that it's a name
-            GedStructure *tmp = ged_names_helper(ss);
-            if (tmp) { tmp->sibling = note; note = tmp; }
+            int32_t tmp = ged_names_helper(r, ss, arena);
             // then change tag
-            changePayloadToConst(&(ss->tag), "TRAN");
-        } else if (!strcmp("GIVN",ss->tag.data)) {
+            r->nodes[ss].tag = GED_TAG_TRAN;
+            r->nodes[ss].tagname = gedTag_name(GED_TAG_TRAN);
+            if (tmp >= 0) { note = tmp; ss = tmp; }
+        } else if (r->nodes[ss].tag == GED_TAG_GIVN) {
             #warning "GIVN not yet handled"
-        } else if (!strcmp("NICK",ss->tag.data)) {
+        } else if (r->nodes[ss].tag == GED_TAG_NICK) {
             #warning "NICK not yet handled"
-        } else if (!strcmp("NPFX",ss->tag.data)) {
+        } else if (r->nodes[ss].tag == GED_TAG_NPFX) {
             #warning "NPFX not yet handled"
-        } else if (!strcmp("NSFX",ss->tag.data)) {
+        } else if (r->nodes[ss].tag == GED_TAG_NSFX) {
             #warning "NSFX not yet handled"
-        } else if (!strcmp("SPFX",ss->tag.data)) {
+        } else if (r->nodes[ss].tag == GED_TAG_SPFX) {
             #warning "NSFX not yet handled"
-        } else if (!strcmp("SURN",ss->tag.data)) {
+        } else if (r->nodes[ss].tag == GED_TAG_SURN) {
             #warning "SURN not yet handled"
-        } else if (!strcmp("_RUFNAM",ss->tag.data) || !strcmp("_RUFNAME",ss->tag.data)) {
+        } else if (r->nodes[ss].tag == GED_TAG__RUFNAM || r->nodes[ss].tag == GED_TAG__RUFNAME) {
             #warning "RUFNAME not yet handled"
         }
 
@@ -143,17 +153,14 @@ GedStructure *ged_names_helper(GedStructure *s) {
 void ged_names(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     // only interested in NAME structures as direct substructures of INDI
     if (event->type == GED_RECORD
-    && !strcmp("INDI", event->record->tag.data)) {
-        for(GedStructure *ptr = event->record->child; ptr; ptr = ptr->sibling) {
-            if (!strcmp("NAME", ptr->tag.data)) {
-                GedStructure *note = ged_names_helper(ptr);
-                if (note) {
-                    note->sibling = ptr->sibling;
-                    ptr->sibling = note;
-                }
+    && event->record->nodes[0].tag == GED_TAG_INDI) {
+        GedRecord *r = event->record;
+        for(int32_t i = r->nodes[0].child; i >= 0; i = r->nodes[i].next) {
+            if (r->nodes[i].tag == GED_TAG_NAME) {
+                int32_t note = ged_names_helper(r, i, emitter->arena);
+                if (note >= 0) i = note;
             }
         }
     }
     emitter->emit(emitter, *event);
 }
-
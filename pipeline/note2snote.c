@@ -9,7 +9,7 @@
 #include <assert.h>
 
 typedef struct {
-    char level;
+    int level;
     char innote;
 } ged_note2snote_state;
 
@@ -21,9 +21,9 @@ void ged_note2snote(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate
     
     if (event->type == GED_START) {
         state->level += 1;
-        if (!strcmp("NOTE", event->data)) {
+        if (ged_tag(event) == GED_TAG_NOTE) {
             if (state->level == 1) {
-                changePayloadToConst(event, "SNOTE");
+                changeTagTo(event, GED_TAG_SNOTE);
                 emitter->emit(emitter, *event);
             } else {
                 state->innote = 1;
@@ -52,3 +52,6 @@ void ged_note2snote(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate
     }
 }
 
+void *ged_note2snotestate_maker() { 
+    return calloc(1, sizeof(ged_note2snote_state));
+}
@@ -37,7 +37,7 @@ void ged_noter2s1(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     struct ged_noter2s1_state *state = (struct ged_noter2s1_state *)rawstate;
     
     if (event->type == GED_RECORD
-    && !strcmp("NOTE", event->record->tag.data)
+    && ged_tag(&event->record->tag) == GED_TAG_NOTE
     && event->record->anchor.type == GED_ANCHOR) {
         trie_put(&state->records, event->record->anchor.data, event->record);
     } else {
@@ -59,12 +59,12 @@ void ged_noter2s_emit_helper(GedEmitterTemplate *emitter, GedEvent e) {
  * (c) does not free anything
  */
 void ged_noter2s_helper(GedEmitterTemplate *emitter, GedStructure *s, struct ged_noter2s1_state *state) {
-    GedEvent end;
+    GedEvent end = {0};
     end.type = GED_END;
     end.flags = 0;
     end.data = 0;
     while (s) {
-        if (!strcmp("NOTE", s->tag.data) && s->payload.type == GED_POINTER) {
+        if (ged_tag(&s->tag) == GED_TAG_NOTE && s->payload.type == GED_POINTER) {
             GedStructure *s2 = trie_get(&state->records, s->payload.data);
             if (s2) {
                 ged_noter2s_emit_helper(emitter, s2->tag);
@@ -93,7 +93,7 @@ void ged_noter2s2(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     
     if (event->type == GED_START) {
         state->level += 1;
-        state->inNote = !strcmp("NOTE", event->data);
+        state->inNote = ged_tag(event) == GED_TAG_NOTE;
         if (state->level == 1)
             state->inNoteRecord = state->inNote;
     }
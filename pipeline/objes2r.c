@@ -25,59 +25,58 @@
 #include <string.h>
 #include <ctype.h>
 
+/// what the walk of one record needs
+struct ged_objes2r_walk {
+    GedEmitterTemplate *emitter;
+    struct ged_serialstate *serial; // see sours2r.c
+};
+
 /**
- * Recursively walk the structure, looking for OBJE with non-pointer 
- * payloads; each one found causes a OBJE record to be emitted and 
- * changes it to have a pointer payload instead.
+ * Called on each structure of a record, looking for OBJE with
+ * non-pointer payloads; each one found causes a OBJE record to be
+ * emitted and changes it to have a pointer payload instead.
  */
-void ged_objes2r_helper(GedStructure *s, GedEmitterTemplate *emitter, long *serial) {
-    while(s) {
-        if (!strcmp("OBJE", s->tag.data) && s->payload.type != GED_POINTER) {
-            GedStructure *or = calloc(1, sizeof(GedStructure));
-            {
-                GedEvent tmp = {GED_START, 0, .data="OBJE"};
-                or->tag = tmp;
-            }
-            
-            // move all substructures except TITL
-            GedStructure **src = &(s->child);
-            GedStructure **dst = &(or->child);
-            while(*src) {
-                if (!strcmp("TITL", (*src)->tag.data)) {
-                    src = &((*src)->sibling);
-                } else {
-                    *dst = *src;
-                    *src = (*src)->sibling;
-                    dst = &((*dst)->sibling);
-                    *dst = 0;
-                }
-            }
-            
-            or->anchor.type = GED_ANCHOR;
-            or->anchor.flags = GED_OWNS_DATA;
-            or->anchor.data = calloc(32,sizeof(char));
-            sprintf(or->anchor.data, "objes2r id %ld", *serial);
-            
-            s->payload.type = GED_POINTER;
-            s->payload.data = strdup(or->anchor.data);
-            s->payload.flags = GED_OWNS_DATA;
-            
-            *serial += 1;
-            
-            {
-                GedEvent tmp = {GED_RECORD, GED_OWNS_DATA, .record=or};
-                emitter->emit(emitter, tmp);
+static int ged_objes2r_pre(GedRecord *r, int32_t i, void *arg) {
+    GedEmitterTemplate *emitter = ((struct ged_objes2r_walk *)arg)->emitter;
+    struct ged_serialstate *serial = ((struct ged_objes2r_walk *)arg)->serial;
+    GedNode *s = r->nodes + i;
+    if (i == 0) return 0; // OBJE records are already records
+    if (s->tag == GED_TAG_OBJE && s->type != GED_POINTER) {
+        GedRecord *or = gedRecord_create(emitter->arena);
+        gedRecord_add(or, emitter->arena, -1, -1, GED_TAG_OBJE, 0);
+        
+        // move all substructures except TITL
+        int32_t *src = &(s->child);
+        int32_t dst = -1;
+        while(*src >= 0) {
+            if (r->nodes[*src].tag == GED_TAG_TITL) {
+                src = &(r->nodes[*src].next);
+            } else {
+                dst = gedRecord_copy(or, emitter->arena, 0, dst, r, *src);
+                *src = r->nodes[*src].next;
             }
         }
-        ged_objes2r_helper(s->child, emitter, serial);
-        s = s->sibling;
+        
+        // fixid renames these to legal ids later
+        or->anchor = gedArena_alloc(emitter->arena, 48);
+        snprintf(or->anchor, 48, "objes2r id %zu %ld", emitter->run, ged_serial_next(serial, emitter));
+        
+        s->type = GED_POINTER;
+        s->len = strlen(or->anchor);
+        s->payload = gedArena_strndup(emitter->arena, or->anchor, s->len);
+        
+        {
+            GedEvent tmp = {GED_RECORD, 0, .record=or};
+            emitter->emit(emitter, tmp);
+        }
     }
+    return 0;
 }
 
 void ged_objes2r(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     if (event->type == GED_RECORD) {
-        ged_objes2r_helper(event->record->child, emitter, rawstate);
+        struct ged_objes2r_walk w = {emitter, rawstate};
+        gedRecord_walk(event->record, 0, ged_objes2r_pre, 0, &w);
     }
     emitter->emit(emitter, *event);
 }
-
@@ -3,33 +3,34 @@
  * events like GED_START, GED_TEXT, etc to represent the same records.
  */
 
-void ged_record2event_helper(GedEmitterTemplate *emitter, GedStructure *s) {
-    GedEvent end;
-    end.type = GED_END;
-    end.flags = 0;
-    end.data = 0;
-    while (s) {
-        emitter->emit(emitter, s->tag);
-        if (s->anchor.type != GED_UNUSED)
-            emitter->emit(emitter, s->anchor);
-        if (s->payload.type != GED_UNUSED)
-            emitter->emit(emitter, s->payload);
-        
-        if (s->child) ged_record2event_helper(emitter, s->child);
-
-        emitter->emit(emitter, end);
-
-        GedStructure *tmp = s;
-        s = s->sibling;
-        free(tmp);
+static int ged_record2event_pre(GedRecord *r, int32_t i, void *emitter) {
+    GedEmitterTemplate *e = (GedEmitterTemplate *)emitter;
+    GedNode *n = r->nodes + i;
+    // nothing in the record is owned, so events just borrow it
+    GedEvent start = {GED_START, 0, n->tag, .data=(char *)n->tagname};
+    e->emit(e, start);
+    if (n->parent < 0 && r->anchor) {
+        GedEvent anchor = {GED_ANCHOR, 0, .data=r->anchor};
+        e->emit(e, anchor);
+    }
+    if (n->type != GED_UNUSED) {
+        GedEvent payload = {n->type, 0, .data=n->payload};
+        e->emit(e, payload);
     }
+    return 0;
+}
+
+static int ged_record2event_post(GedRecord *r, int32_t i, void *emitter) {
+    GedEmitterTemplate *e = (GedEmitterTemplate *)emitter;
+    GedEvent end = {GED_END, 0};
+    e->emit(e, end);
+    return 0;
 }
 
 void ged_record2event(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     if (event->type == GED_RECORD) {
-        ged_record2event_helper(emitter, event->record);
+        gedRecord_walk(event->record, 0, ged_record2event_pre, ged_record2event_post, emitter);
     } else {
         emitter->emit(emitter, *event);
     }
 }
-
@@ -6,9 +6,9 @@ void ged_rela2role(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
     long *state = (long *)rawstate;
     
     if (event->type == GED_START) {
-        *state = !strcmp("RELA", event->data);
+        *state = ged_tag(event) == GED_TAG_RELA;
         if (*state)
-            changePayloadToConst(event, "ROLE");
+            changeTagTo(event, GED_TAG_ROLE);
     }
     
     if (event->type == GED_TEXT && *state) {
@@ -58,7 +58,7 @@ void ged_rela2role(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate)
             enumerated = "OTHER";
         
         emitter->emit(emitter, (GedEvent){GED_TEXT, 0, .data=enumerated});
-        if (ged_few_phrases ? !strcasecmp(enumerated, "OTHER") : strcasecmp(enumerated, event->data)) {
+        if (emitter->options->few_phrases ? !strcasecmp(enumerated, "OTHER") : strcasecmp(enumerated, event->data)) {
             emitter->emit(emitter, (GedEvent){GED_START, 0, .data="PHRASE"});
             emitter->emit(emitter, *event);
             emitter->emit(emitter, (GedEvent){GED_END, 0, .data=0});
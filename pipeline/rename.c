@@ -14,11 +14,16 @@
  *
  * Defered: _SDATE -> SDATE -- unsure about this one, some _SDATE are "accessed at" dates instead
  * 
- * Should be before `enums`, `rela2role`, and `addschma`
+ * Should be before `enums` and `rela2role`. It comes after `addschma`,
+ * which as a two-pass entry must come before every filter without a
+ * first pass (see config.h). That changes nothing: pass 1 runs only
+ * first-pass functions, so `addschma` never saw these renames when it
+ * came after this either (it still counts, e.g., _EMAIL as used), and
+ * its second pass only adds HEAD.SCHMA, which this leaves alone.
  */
 
 struct ged_rename_state {
-    char formLevel;
+    int formLevel;
 };
 
 void ged_rename(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
@@ -27,29 +32,22 @@ void ged_rename(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     
     if (event->type == GED_START) {
         if (state->formLevel) state->formLevel += 1;
-        else if (!strcmp("FORM", event->data)) state->formLevel = 1;
+        else if (ged_tag(event) == GED_TAG_FORM) state->formLevel = 1;
         
-        if (state->formLevel == 2 && !strcmp("TYPE", event->data))
-            changePayloadToConst(event, "MEDI");
-        
-        if (!strcmp("_ASSO", event->data))
-            changePayloadToConst(event, "ASSO");
-        if (!strcmp("_CRE", event->data))
-            changePayloadToConst(event, "CREA");
-        if (!strcmp("_CREAT", event->data))
-            changePayloadToConst(event, "CREA");
-        if (!strcmp("_DATE", event->data))
-            changePayloadToConst(event, "DATE");
-        if (!strcmp("EMAI", event->data))
-            changePayloadToConst(event, "EMAIL");
-        if (!strcmp("_EMAIL", event->data))
-            changePayloadToConst(event, "EMAIL");
-        if (!strcmp("_INIT", event->data))
-            changePayloadToConst(event, "INIL");
-        //if (!strcmp("_SDATE", event->data))
-            //changePayloadToConst(event, "SDATE");
-        if (!strcmp("_UID", event->data))
-            changePayloadToConst(event, "UID");
+        switch(ged_tag(event)) {
+            case GED_TAG_TYPE:
+                if (state->formLevel == 2) changeTagTo(event, GED_TAG_MEDI);
+                break;
+            case GED_TAG__ASSO: changeTagTo(event, GED_TAG_ASSO); break;
+            case GED_TAG__CRE: changeTagTo(event, GED_TAG_CREA); break;
+            case GED_TAG__CREAT: changeTagTo(event, GED_TAG_CREA); break;
+            case GED_TAG__DATE: changeTagTo(event, GED_TAG_DATE); break;
+            case GED_TAG_EMAI: changeTagTo(event, GED_TAG_EMAIL); break;
+            case GED_TAG__EMAIL: changeTagTo(event, GED_TAG_EMAIL); break;
+            case GED_TAG__INIT: changeTagTo(event, GED_TAG_INIL); break;
+            //case GED_TAG__SDATE: changeTagTo(event, GED_TAG_SDATE); break;
+            case GED_TAG__UID: changeTagTo(event, GED_TAG_UID); break;
+        }
         
     } else if (event->type == GED_END) {
         if (state->formLevel > 0) state->formLevel -= 1;
@@ -58,3 +56,6 @@ void ged_rename(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     emitter->emit(emitter, *event);
 }
 
+void *ged_renamestate_maker() { 
+    return calloc(1, sizeof(struct ged_rename_state));
+}
@@ -29,83 +29,90 @@
 
 
 /**
- * Recursively walk the structure, looking for SOUR with text payloads;
- * each one found causes a source record to be emitted and changes it
- * to have a pointer payload instead.
+ * Numbers the records a filter makes, counting afresh in each run of
+ * records (see `GedEmitterTemplate.run`), so that with the run they
+ * make ids that are the same on every conversion of the same input.
  */
-void ged_sours2r_helper(GedStructure *s, GedEmitterTemplate *emitter, long *serial) {
-    while(s) {
-        if (!strcmp("SOUR", s->tag.data) && s->payload.type == GED_TEXT) {
-            
-            GedStructure *n = calloc(1, sizeof(GedStructure));
-            {
-                GedEvent tmp = {GED_START, 0, .data="NOTE"};
-                n->tag = tmp;
-            }
-            n->payload = s->payload;
-            
-            GedStructure *sr = calloc(1, sizeof(GedStructure));
-            sr->child = n;
-            {
-                GedEvent tmp = {GED_START, 0, .data="SOUR"};
-                sr->tag = tmp;
-            }
-            sr->anchor.type = GED_ANCHOR;
-            sr->anchor.flags = GED_OWNS_DATA;
-            sr->anchor.data = calloc(32,sizeof(char));
-            sprintf(sr->anchor.data, "sours2r id %ld", *serial);
-            
-            s->payload.type = GED_POINTER;
-            s->payload.data = strdup(sr->anchor.data);
-            s->payload.flags = GED_OWNS_DATA;
-            
-            *serial += 1;
-            
-            {
-                GedEvent tmp = {GED_RECORD, GED_OWNS_DATA, .record=sr};
-                emitter->emit(emitter, tmp);
-            }
+struct ged_serialstate {
+    size_t run;
+    long serial;
+};
+void *ged_serialstate_maker() { return calloc(1, sizeof(struct ged_serialstate)); }
 
-            // Create DATA and move any TEXT into it
-            GedStructure *data = calloc(1, sizeof(GedStructure));
-            data->tag = (GedEvent){GED_START, 0, .data="DATA"};
-            GedStructure *tail = 0;
-            if (s->child && !strcmp("TEXT", s->child->tag.data)) {
-                tail = data->child = s->child;
-                data->sibling = s->child->sibling;
-                s->child = data;
-                tail->sibling = 0;
-            }
-            GedStructure *end = s->child;
-            while(end && end->sibling) {
-                if (!strcmp("TEXT", end->sibling->tag.data)) {
-                    if (!tail) {
-                        tail = data->child = end->sibling;
-                        end->sibling = data;
-                        data->sibling = tail->sibling;
-                        tail->sibling = 0;
-                    } else {
-                        tail = tail->sibling = end->sibling;
-                        end->sibling = end->sibling->sibling;
-                        tail->sibling = 0;
-                    }
-                } else {
-                    end = end->sibling;
-                }
-            }
-            if (!tail) free(data);
+/// the next number of `state` in the emitter's run
+static long ged_serial_next(struct ged_serialstate *state, GedEmitterTemplate *emitter) {
+    if (state->run != emitter->run) {
+        state->run = emitter->run;
+        state->serial = 0;
+    }
+    return state->serial++;
+}
+
+/// what the walk of one record needs
+struct ged_sours2r_walk {
+    GedEmitterTemplate *emitter;
+    struct ged_serialstate *serial;
+};
 
+/**
+ * Called on each structure of a record, looking for SOUR with
+ * text payloads; each one found causes a source record to be
+ * emitted and changes it to have a pointer payload instead.
+ */
+static int ged_sours2r_pre(GedRecord *r, int32_t i, void *arg) {
+    GedEmitterTemplate *emitter = ((struct ged_sours2r_walk *)arg)->emitter;
+    struct ged_serialstate *serial = ((struct ged_sours2r_walk *)arg)->serial;
+    GedNode *s = r->nodes + i;
+    if (i == 0) return s->tag == GED_TAG_HEAD; // HEAD.SOUR is not a citation
+    if (s->tag == GED_TAG_SOUR && s->type == GED_TEXT) {
+        
+        GedRecord *sr = gedRecord_create(emitter->arena);
+        gedRecord_add(sr, emitter->arena, -1, -1, GED_TAG_SOUR, 0);
+        int32_t n = gedRecord_add(sr, emitter->arena, 0, -1, GED_TAG_NOTE, 0);
+        sr->nodes[n].type = GED_TEXT;
+        sr->nodes[n].payload = s->payload;
+        sr->nodes[n].len = s->len;
+        
+        // fixid renames these to legal ids later
+        sr->anchor = gedArena_alloc(emitter->arena, 48);
+        snprintf(sr->anchor, 48, "sours2r id %zu %ld", emitter->run, ged_serial_next(serial, emitter));
+        
+        s->type = GED_POINTER;
+        s->len = strlen(sr->anchor);
+        s->payload = gedArena_strndup(emitter->arena, sr->anchor, s->len);
+        
+        {
+            GedEvent tmp = {GED_RECORD, 0, .record=sr};
+            emitter->emit(emitter, tmp);
         }
-        ged_sours2r_helper(s->child, emitter, serial);
-        s = s->sibling;
+
+        // Create DATA where the first TEXT is and move every TEXT into it
+        int32_t data = -1, tail = -1, prev = -1;
+        for(int32_t c = s->child; c >= 0; ) {
+            int32_t next = r->nodes[c].next;
+            if (r->nodes[c].tag != GED_TAG_TEXT) {
+                prev = c;
+            } else {
+                if (data < 0) // may move r->nodes
+                    prev = data = gedRecord_add(r, emitter->arena, i, prev, GED_TAG_DATA, 0);
+                r->nodes[prev].next = next;
+                r->nodes[c].parent = data;
+                r->nodes[c].next = -1;
+                if (tail < 0) r->nodes[data].child = c;
+                else r->nodes[tail].next = c;
+                tail = c;
+            }
+            c = next;
+        }
+
     }
+    return 0;
 }
 
 void ged_sours2r(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     if (event->type == GED_RECORD) {
-        if (strcmp("HEAD", event->record->tag.data))
-            ged_sours2r_helper(event->record->child, emitter, rawstate);
+        struct ged_sours2r_walk w = {emitter, rawstate};
+        gedRecord_walk(event->record, 0, ged_sours2r_pre, 0, &w);
     }
     emitter->emit(emitter, *event);
 }
-
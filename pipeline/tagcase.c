@@ -21,14 +21,17 @@ int ged_tagcase_capitalize_legal(char *s) {
  */
 void ged_tagcase(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     
-    if (event->type == GED_START) {
-        // WARNING: if !GED_OWNS_DATA, might change someone else's text
+    // tags the parser interned are shared and known to be upper-case
+    // already; GED_TAG_EXTENSION is only what `ged_tag` found for a
+    // spelling, which may be lower-case
+    if (event->type == GED_START && (!event->tag || event->tag == GED_TAG_EXTENSION)) {
         int res = ged_tagcase_capitalize_legal(event->data);
         if (res) {
             ged_destroy_event(event);
             event->type = GED_ERROR;
             event->data = "Encountered illegal character inside tag";
         }
+        else event->tag = GED_TAG_NONE; // look up the new spelling
     }
     
     emitter->emit(emitter, *event);
@@ -13,7 +13,7 @@
 
 struct ged_tran_state {
     char inWhat; // 1 = FONE, 2 = ROMN, 0 = other
-    char depth; // levels past start
+    int depth; // levels past start
     char inType; // 0 = not in FONE.TYPE or ROMN.TYPE; 1 = in
 };
 
@@ -27,17 +27,17 @@ void ged_tran(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     
     if (event->type == GED_START) {
         if (state->inWhat) state->depth += 1;
-        else if (!strcmp("FONE",event->data)) {
+        else if (ged_tag(event) == GED_TAG_FONE) {
             state->inWhat = 1;
-            changePayloadToConst(event, "TRAN");
-        } else if (!strcmp("ROMN",event->data)) {
+            changeTagTo(event, GED_TAG_TRAN);
+        } else if (ged_tag(event) == GED_TAG_ROMN) {
             state->inWhat = 2;
-            changePayloadToConst(event, "TRAN");
+            changeTagTo(event, GED_TAG_TRAN);
         }
         
-        if (state->depth == 1 && !strcmp("TYPE",event->data)) {
+        if (state->depth == 1 && ged_tag(event) == GED_TAG_TYPE) {
             state->inType = 1;
-            changePayloadToConst(event, "LANG");
+            changeTagTo(event, GED_TAG_LANG);
         }
         else state->inType = 0;
     } else if (event->type == GED_END) {
@@ -72,3 +72,7 @@ void ged_tran(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     }
     emitter->emit(emitter, *event);
 }
+
+void *ged_transtate_maker() { 
+    return calloc(1, sizeof(struct ged_tran_state));
+}
@@ -8,15 +8,15 @@
 void ged_unconc(GedEvent *event, GedEmitterTemplate *emitter, void *state) {
     long *flags = (long *)state;
     if (event->type == GED_START) {
-        if (strcmp(event->data, "CONC") == 0) {
+        if (ged_tag(event) == GED_TAG_CONC) {
             *flags = 1;
             ged_destroy_event(event);
             return;
         }
-        if (strcmp(event->data, "CONT") == 0) {
+        if (ged_tag(event) == GED_TAG_CONT) {
             *flags = 1;
             ged_destroy_event(event);
-            GedEvent ans;
+            GedEvent ans = {0};
             ans.type = GED_LINEBREAK;
             ans.data = 0; ans.flags = 0;
             emitter->emit(emitter, ans);
@@ -3,9 +3,9 @@
  */
 
 struct ged_version_state {
-    char level;
+    int level;
     char postGedc;
-    char cutLevel;
+    int cutLevel;
 };
 
 void ged_version(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
@@ -14,7 +14,7 @@ void ged_version(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
     if (event->type == GED_START) {
         state->level += 1;
 
-        if (!state->cutLevel && !strcmp("GEDC",event->data)) {
+        if (!state->cutLevel && ged_tag(event) == GED_TAG_GEDC) {
             state->cutLevel = state->level;
             if (!state->postGedc) {
                 state->postGedc = 1;
@@ -48,3 +48,6 @@ void ged_version(GedEvent *event, GedEmitterTemplate *emitter, void *rawstate) {
         ged_destroy_event(event);
 }
 
+void *ged_versionstate_maker() { 
+    return calloc(1, sizeof(struct ged_version_state));
+}
@@ -1,118 +1,90 @@
 #include <stdlib.h>
-#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include "strtrie.h"
 
-struct trie_node_t {
-    char c;
-    union {
-        struct trie_node_t *k; // first child if c != 0
-        size_t kvindex; // index into array if c == 0
-    };
-    struct trie_node_t *s; // next sibling
-};
-
 /**
- * searches for string. If found, returns pointer to last trie_node
- * which always has c==0. If not found, returns NULL.
+ * One slot of the hash table. The full hash is kept beside the index
+ * so that probing rarely needs to look at the key itself.
  */
-trie_node *trie_get_helper(trie_node *t, const char *key) {
-    while(*key && t) {
-        while (t && t->c != *key) t = t->s; // linear search
-        if (!t) return 0;
-        t = t->k;
-        key += 1;
-    }
-    while (t && t->c) t = t->s;
-    return t;
+struct trie_slot_t {
+    uint32_t hash;
+    uint32_t index; // 1 + index into kvpairs, or 0 if the slot is empty
+};
+
+/// FNV-1a
+static uint32_t trie_hash(const char *key) {
+    uint32_t h = 2166136261u;
+    for(; *key; key+=1) h = (h ^ (unsigned char)*key) * 16777619u;
+    return h;
 }
 
 /**
- * Inserts a string. Returns pointer to last trie_node, which always 
- * has c==0. If already in t, returns same as trie_get; otherwise,
- * allocates nodes using malloc.
+ * Finds the slot holding `key`, or the empty slot where it belongs if
+ * it is not present.
  */
-trie_node *trie_add_helper(trie_node *t, const char *key) {
-    trie_node *old = t;
-    while(*key && t) {
-        while (t && t->c != *key) { // linear search
-            old = t;
-            t = t->s;
-        }
-        if (!t) break;
-        t = t->k;
-        key += 1;
-    }
-    if (t && !*key) {
-        while (t && t->c) { old=t; t = t->s; }
-        if (t) return t; // found it already in tie
+static trie_slot *trie_find(trie *t, const char *key, uint32_t hash) {
+    size_t mask = t->cap - 1;
+    for(size_t i = hash & mask; ; i = (i+1) & mask) {
+        trie_slot *s = t->t + i;
+        if (!s->index) return s;
+        if (s->hash == hash && !strcmp(t->kvpairs[2*(s->index-1)], key)) return s;
     }
-    // here old points to last sibling of last row without item
-    // add a sibling, then children to the end
-    old->s = malloc(sizeof(trie_node));
-    t = old->s;
-    while(*key) {
-        t->c = *key;
-        t->s = 0;
-        t->k = malloc(sizeof(trie_node));
-        key += 1;
-        t = t->k;
+}
+
+/// doubles the number of slots and the room in kvpairs
+static void trie_grow(trie *t) {
+    trie_slot *old = t->t;
+    size_t oldcap = t->cap;
+    t->cap = oldcap ? oldcap * 2 : 16;
+    t->t = calloc(t->cap, sizeof(trie_slot));
+    t->kvpairs = realloc(t->kvpairs, t->cap * sizeof(void *)); // 2 per entry, cap/2 entries
+    for(size_t i=0; i<oldcap; i+=1) {
+        if (!old[i].index) continue;
+        size_t j = old[i].hash & (t->cap - 1);
+        while (t->t[j].index) j = (j+1) & (t->cap - 1);
+        t->t[j] = old[i];
     }
-    t->c = 0;
-    t->s = 0;
-    t->kvindex = ~(0UL);
-    return t;    
+    free(old);
 }
 
 void *trie_get(trie *t, const char *key) {
-    trie_node *leaf = trie_get_helper(t->t, key);
-    if (leaf) return t->kvpairs[2*leaf->kvindex+1];
+    if (!t->t) return 0;
+    trie_slot *s = trie_find(t, key, trie_hash(key));
+    if (s->index) return t->kvpairs[2*(s->index-1)+1];
     else return 0;
 }
+
 void *trie_put(trie *t, const char *key, void *val) {
-    if (!t->t) {
-        t->kvpairs = malloc(sizeof(void *)*2);
-        t->kvpairs[0] = (void *)key;
-        t->kvpairs[1] = val;
-        t->length = 1;
-        trie_node *tr = malloc(sizeof(trie_node));
-        t->t = tr;
-        while(*key) {
-            tr->c = *key;
-            tr->s = 0;
-            tr->k = malloc(sizeof(trie_node));
-            key += 1;
-            tr = tr->k;
-        }
-        tr->c = 0;
-        tr->s = 0;
-        tr->kvindex = 0;
-        return 0;
-    } else {
-        trie_node *leaf = trie_add_helper(t->t, key);
-        if (leaf->kvindex < ~(0UL)) {
-            void *old = t->kvpairs[2*leaf->kvindex + 1];
-            t->kvpairs[2*leaf->kvindex + 1] = val;
-            return old;
-        } else {
-            leaf->kvindex = t->length;
-            t->length += 1;
-            t->kvpairs = realloc(t->kvpairs, t->length*2*sizeof(void *));
-            t->kvpairs[2*leaf->kvindex + 0] = (void *)key;
-            t->kvpairs[2*leaf->kvindex + 1] = val;
-            return 0;
-        }
+    if (!t->t) { // "t.t = 0" is the only initialization callers do
+        t->kvpairs = 0;
+        t->length = 0;
+        t->cap = 0;
+        trie_grow(t);
     }
-}
-
-void trie_free_helper(trie_node *t) {
-    if (!t) return;
-    if (t->s) trie_free_helper(t->s);
-    if (t->c) trie_free_helper(t->k);
+    uint32_t hash = trie_hash(key);
+    trie_slot *s = trie_find(t, key, hash);
+    if (s->index) {
+        void *old = t->kvpairs[2*(s->index-1)+1];
+        t->kvpairs[2*(s->index-1)+1] = val;
+        return old;
+    }
+    if (2*(t->length+1) > t->cap) {
+        trie_grow(t);
+        s = trie_find(t, key, hash);
+    }
+    t->kvpairs[2*t->length + 0] = (void *)key;
+    t->kvpairs[2*t->length + 1] = val;
+    t->length += 1;
+    s->hash = hash;
+    s->index = t->length;
+    return 0;
 }
 
 void trie_free(trie *t) {
-    if (t->t) free(t->kvpairs);
-    trie_free_helper(t->t);
+    if (t->t) {
+        free(t->kvpairs);
+        free(t->t);
+    }
     t->t = 0;
 }
-
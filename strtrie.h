@@ -1,11 +1,11 @@
 /**
- * A trie implementation of a map<string, string>.
+ * A hash map implementation of a map<string, string>.
  * 
- * This is a trie simply because they require less code than a hashmap
- * or self-balancing binary BST. Because iterating through the keys of 
- * a trie requires some nontrivial iterator structures, the trie also
- * incudes a parallel array of key:value pairs. This is space-wasteful
- * and should be replaced if very very large datasets are contemplated.
+ * This used to be a trie, hence the name; it is now an open-addressing
+ * hash table with linear probing, which needs barely more code and
+ * does not slow down as keys grow long or numerous. Because iterating
+ * through a hash table yields keys in no useful order, the map also
+ * keeps a parallel array of key:value pairs in first-insertion order.
  * 
  * trie t; t.t = 0;       // no other initialization needed
  * trie_put(&t, "key", "value");
@@ -24,15 +24,18 @@
 
 #pragma once
 
-typedef struct trie_node_t trie_node;
+#include <stddef.h> // size_t
+
+typedef struct trie_slot_t trie_slot;
 
 /**
- * Trie container structure.
+ * Map container structure.
  */
 typedef struct {
-    trie_node *t; // log(n) lookup
+    trie_slot *t; // O(1) lookup; `cap` slots, at most half of them used
     void **kvpairs; // iteration; kvpairs[2*i] is a key, kvpairs[2*i+1] is its value
     size_t length; // number of entries
+    size_t cap; // number of slots in `t`, a power of two
 } trie;
 
 /**